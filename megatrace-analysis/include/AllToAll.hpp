@@ -0,0 +1,29 @@
+#ifndef CONFIG_ALL_TO_ALL
+#define CONFIG_ALL_TO_ALL
+#include <vector>
+#include <fstream>
+#include "Config.hpp"
+#include "GraphNode.hpp"
+
+// A run of Send/Recv records is a grouped all-to-all when it holds at least
+// two of each; the PP send/recv at the edges of a process come alone.
+bool isAllToAll(int sends, int recvs);
+
+// Appends the all-to-all bursts of a finished F/B process,
+// logs[startIdx - 1 .. endIdx - 1], to the rank's EP_info entry. A run
+// holding several all-to-alls back to back is cut every epSize sends and
+// epSize recvs.
+void fillAllToAll(Iteration &iteration, const Rank &rank, const TrainingProcess &process,
+                  const std::vector<NCCLLog> &logs);
+
+void writeAllToAllHeader(std::ofstream &outFile);
+
+// Matches the k-th burst of every member of an EP group and reports, per
+// rank and phase, the time spent in all-to-all and the wait it caused the
+// others by arriving last, and per rank its share of the bytes received
+// into its experts (the dispatch in F, the combine gradient in B). A rank
+// that receives more tokens runs its experts longer and arrives late at the
+// next burst, so a straggler with a large share is put down to token
+// imbalance.
+void reportAllToAll(std::ofstream &outFile, const Iteration &iteration, Rank *ranks, const TrainingConfig &config);
+#endif
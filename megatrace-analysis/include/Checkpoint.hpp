@@ -0,0 +1,39 @@
+#ifndef CONFIG_CHECKPOINT
+#define CONFIG_CHECKPOINT
+#include <vector>
+#include <string>
+#include <ios>
+#include "Config.hpp"
+
+// Where a worker starts reading: the first record of the first F/B process
+// of an iteration
+struct ResumePoint
+{
+    size_t iteration;
+    std::streamoff position; // byte offset in rank_N.log, record index in a store
+    double pendingRecvTime;  // the PP recv just before that record
+};
+
+// <checkpointPath>: how far a growing job has been analysed. Iterations
+// before nextIteration are closed, every rank has started the one after,
+// and are not read again; the PP baseline and the drift detectors as of the
+// last closed iteration are kept next to it in <checkpointPath>.baseline and
+// <checkpointPath>.drift.
+struct Checkpoint
+{
+    size_t nextIteration;
+    std::vector<ResumePoint> ranks;
+
+    Checkpoint();
+    // false, and a cold start, when it was written for another model or input
+    bool load(const std::string &path, const TrainingConfig &config);
+    bool save(const std::string &path, const TrainingConfig &config) const;
+};
+
+std::string checkpointBaselinePath(const std::string &path);
+std::string checkpointDriftPath(const std::string &path);
+
+// the processes of pattern from iteration on, with record indices counted
+// from that iteration's first record
+std::vector<TrainingProcess> resumePattern(const std::vector<TrainingProcess> &pattern, size_t iteration);
+#endif
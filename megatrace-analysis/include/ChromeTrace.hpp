@@ -0,0 +1,41 @@
+#ifndef CONFIG_CHROME_TRACE
+#define CONFIG_CHROME_TRACE
+#include <string>
+#include <vector>
+#include <fstream>
+#include <unordered_map>
+#include "GraphNode.hpp"
+#include "Telemetry.hpp"
+
+// Streams Chrome JSON trace events (loadable in ui.perfetto.dev and
+// chrome://tracing) one iteration at a time: a process per rank, thread 0
+// holds the iteration and F/B process slices, one thread per communicator
+// (comm hash, else stream) holds the collectives: a slice spanning the rank's
+// transfers when telemetry has them, else an instant at the host enqueue.
+// Only the track ids are kept between iterations.
+class ChromeTraceWriter
+{
+public:
+    ChromeTraceWriter(Rank *ranks, int numRanks);
+
+    bool open(const std::string &path);
+    bool is_open() const;
+    void addIteration(const Iteration &iteration, const TelemetryIndex &telemetry);
+    // terminates the JSON array; also called by the destructor
+    void close();
+    ~ChromeTraceWriter();
+
+private:
+    Rank *ranks;
+    int numRanks;
+    std::ofstream out;
+    bool first;
+    double origin;
+    std::vector<std::unordered_map<std::string, int>> tracks;
+
+    int track(int rank, const std::string &name);
+    void event(const std::string &json);
+    void slice(const std::string &name, const char *category, int pid, int tid, double start, double end, const std::string &args);
+    void instant(const std::string &name, const char *category, int pid, int tid, double time, const std::string &args);
+};
+#endif
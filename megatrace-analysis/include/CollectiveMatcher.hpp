@@ -0,0 +1,67 @@
+#ifndef CONFIG_COLLECTIVE_MATCHER
+#define CONFIG_COLLECTIVE_MATCHER
+#include <string>
+#include <vector>
+#include <fstream>
+#include <unordered_map>
+#include "Rank.hpp"
+#include "LogParser.hpp"
+
+// Arrivals of the k-th collective of one communicator, accumulated over its
+// member ranks in O(1) per record.
+struct CollectiveArrival
+{
+    std::string ncclFunction;
+    unsigned long long opCount;
+    double base;
+    double first;
+    double last;
+    double sum;
+    int firstRank;
+    int lastRank;
+    int count;
+
+    CollectiveArrival();
+
+    void add(const NCCLLog &log);
+    double skew() const;
+    // total time the other members spent waiting for the last arrival
+    double waitCaused() const;
+};
+
+// Per-rank straggler metrics of one iteration
+struct RankSkew
+{
+    int lateCount;
+    double waitCaused;
+    double maxSkew;
+    std::string maxSkewFunction;
+
+    RankSkew();
+};
+
+// Communicator key of every record of one rank, empty for records that are
+// not matched (P2P, or streams without a known role)
+std::vector<std::string> collectiveKeys(const std::vector<NCCLLog> &logs, const Rank &rank);
+
+// (communicator, ordinal) -> arrivals; ordinals count collectives per
+// communicator from the start of the iteration on every rank. keys[r][i] and
+// ordinals[r][i] locate record i of rank r, keys are empty for unmatched ones.
+std::unordered_map<std::string, std::vector<CollectiveArrival>>
+collectArrivals(const std::vector<std::vector<NCCLLog>> &historyLogs, Rank *ranks, int numRanks,
+                std::vector<std::vector<std::string>> &keys, std::vector<std::vector<size_t>> &ordinals);
+
+// Matches the k-th collective on each communicator across its member ranks.
+// Records tagged with a comm hash are keyed by it; older records fall back to
+// stream roles: the rank's most frequent stream is its TP communicator and
+// the stream carrying ReduceScatter its DP communicator.
+std::vector<RankSkew> matchCollectives(const std::vector<std::vector<NCCLLog>> &historyLogs, Rank *ranks, int numRanks);
+
+// Time the last member arrived at the collective of every record, per rank
+// and record of historyLogs; 0 for records that were not matched.
+std::vector<std::vector<double>> lastArrivals(const std::vector<std::vector<NCCLLog>> &historyLogs, Rank *ranks, int numRanks);
+
+void writeSkewHeader(std::ofstream &outFile);
+
+void reportSkew(std::ofstream &outFile, const std::vector<RankSkew> &skews, int iteration);
+#endif
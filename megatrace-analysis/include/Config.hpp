@@ -2,6 +2,8 @@
 #define CONFIG_LOG_CONFIG
 #include <iostream>
 #include <vector>
+#include <set>
+#include <string>
 struct TrainingProcess
 {
     std::string name;
@@ -28,12 +30,74 @@ struct TrainingConfig
     int ppGroupSize;
     int dpGroupSize;
     double slowThreshold;
+    std::string telemetryPath;
+    double telemetryWindow;
+    double linkSlowRatio;
+    double layerSlowRatio;
+    std::string baselineEstimator;
+    double ewmaAlpha;
+    int baselineWarmup;
+    double madThreshold;
+    std::string excludeIterations;
+    std::string baselinePath;
+    int driftWarmup;
+    double driftDelta;
+    double driftThreshold;
+    double liveDeadline;
+    std::string whatIfRanks;
+    bool chromeTrace;
+    bool ganttChart;
+    bool outputArchive;
+    bool archiveCompress;
+    int triageTopK;
+    std::string checkpointPath;
+    bool learnPattern;
+    int vpSize;
+    int epSize;
+    int epGroupSize;
+    double tokenImbalanceRatio;
+    double alltoallSkewRatio;
+    double layerMinExcess;
 };
 
+// "1,10,20-22" -> {1, 10, 20, 21, 22}; also used for rank lists
+std::set<int> parseIterationList(const std::string &list);
+
+// Process names are "<microbatch>F<virtual stage>" and
+// "<microbatch>B<last virtual stage - virtual stage>"; with vpSize model
+// chunks per rank, chunk c of stage p is virtual stage c * ppSize + p. With
+// vpSize > 1 the stages run Megatron's interleaved 1F1B schedule.
 std::vector<std::vector<TrainingProcess>> gen_training_pattern(TrainingConfig config);
 
-void _gen_training_pattern_withSP(int layerNumPerRank, std::vector<std::vector<TrainingProcess>> &trainingPatterns);
+// the virtual stage of a process name, -1 if it is not an F/B process
+int virtualStage(const std::string &name, int ppSize, int vpSize);
+
+// "3F1" -> (3, 'F'); false if it is not an F/B process
+bool parseProcessName(const std::string &name, int &batch, char &direction);
+
+// Record counts of one (virtual) stage: the records before the first
+// iteration, one F and one B process including their PP send/recv, and the
+// records after the last B of an iteration
+struct StageLayout
+{
+    int preamble;
+    int forward;
+    int backward;
+    int tail;
+};
+
+// the counts of the supported Megatron version; with model chunks, pass the
+// virtual stage, the number of virtual stages and the layers of a chunk
+StageLayout handLayout(int layerNumPerRank, size_t ppIdx, size_t ppSize, bool isSP);
+
+// fills startIdx/endIdx of one stage's processes from the layout of each of
+// its chunks (the preamble and tail of the first); without SP the PP
+// send/recv at the edges of a process are left out of it
+void layoutStage(std::vector<TrainingProcess> &processes, size_t ppSize, size_t vpSize,
+                 const std::vector<StageLayout> &chunks, bool isSP);
+
+void _gen_training_pattern_withSP(int layerNumPerRank, int vpSize, std::vector<std::vector<TrainingProcess>> &trainingPatterns);
 
-void _gen_training_pattern_withoutSP(int layerNumPerRank, std::vector<std::vector<TrainingProcess>> &trainingPatterns);
+void _gen_training_pattern_withoutSP(int layerNumPerRank, int vpSize, std::vector<std::vector<TrainingProcess>> &trainingPatterns);
 
 #endif
\ No newline at end of file
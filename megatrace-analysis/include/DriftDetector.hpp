@@ -0,0 +1,52 @@
+#ifndef CONFIG_DRIFT_DETECTOR
+#define CONFIG_DRIFT_DETECTOR
+#include <string>
+#include <vector>
+#include <fstream>
+#include <unordered_map>
+#include "Config.hpp"
+#include "GraphNode.hpp"
+#include "Telemetry.hpp"
+
+// One-sided CUSUM (Page's test) on one series, relative to the mean of its
+// first warmup samples: sum += x / reference - 1 - delta, clamped at 0; the
+// drift began after the last iteration the sum was 0. O(1) per sample.
+struct DriftDetector
+{
+    double reference;
+    double sum;
+    int count;
+    int since;
+
+    DriftDetector();
+
+    // returns true when the sum exceeds threshold; the detector then
+    // re-baselines on the following samples
+    bool add(double x, int iteration, int warmup, double delta, double threshold);
+};
+
+// Drift state of every series across iterations: per rank its F/B time, per
+// communicator its collective latency from telemetry. Without telemetry the
+// logs only give the interval between collectives, mostly the compute in
+// between, so the communicator series is not tracked.
+struct DriftMonitor
+{
+    int warmup;
+    double delta;
+    double threshold;
+    std::unordered_map<int, DriftDetector> ranks;
+    std::unordered_map<std::string, DriftDetector> comms;
+
+    DriftMonitor(const TrainingConfig &config);
+
+    void addIteration(std::ofstream &outFile, const Iteration &iteration, Rank *rankInfo, int numRanks,
+                      const TelemetryIndex &telemetry);
+
+    // the detectors' state, so a resumed run continues the CUSUM instead of
+    // warming up again; load is false when written for another model
+    bool save(const std::string &path, const std::string &model) const;
+    bool load(const std::string &path, const std::string &model);
+};
+
+void writeDriftHeader(std::ofstream &outFile);
+#endif
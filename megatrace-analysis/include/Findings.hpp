@@ -0,0 +1,87 @@
+#ifndef CONFIG_FINDINGS
+#define CONFIG_FINDINGS
+#include <string>
+#include <vector>
+#include <sstream>
+#include <type_traits>
+#include "Rank.hpp"
+
+// One finding of any analysis. emit() prints the human-readable line
+// "TYPE: <type>, KEY: value, ..." and, while a report is open, appends the
+// same finding as one NDJSON object: keys lowercased, numbers as numbers,
+// booleans printed 0/1 and reported as JSON booleans, lists (per-stage
+// values, member ranks) printed "a/b" and reported as JSON arrays, rank
+// findings with the rank's TP/PP/DP group ids.
+class Finding
+{
+public:
+    explicit Finding(const std::string &type);
+
+    Finding &rank(int id);
+    Finding &add(const std::string &key, const std::string &value);
+    Finding &add(const std::string &key, const char *value);
+    Finding &add(const std::string &key, bool value);
+    template <typename T, typename = typename std::enable_if<std::is_arithmetic<T>::value>::type>
+    Finding &add(const std::string &key, T value)
+    {
+        std::ostringstream text;
+        text << value;
+        return field(key, text.str(), true, true);
+    }
+    template <typename T>
+    Finding &add(const std::string &key, const std::vector<T> &values)
+    {
+        return list(key, values, true);
+    }
+    // report-only fields (slack, confidence, ...), not printed
+    template <typename T>
+    Finding &data(const std::string &key, T value)
+    {
+        std::ostringstream text;
+        text << value;
+        return field(key, text.str(), std::is_arithmetic<T>::value, false, false, std::is_same<T, bool>::value);
+    }
+    template <typename T>
+    Finding &data(const std::string &key, const std::vector<T> &values)
+    {
+        return list(key, values, false);
+    }
+    void emit() const;
+
+private:
+    struct Field
+    {
+        std::string key;
+        std::string text;
+        bool isNumber;
+        bool isPrinted;
+        bool isList;
+        bool isBool;
+    };
+    std::string type;
+    int rankID;
+    std::vector<Field> fields;
+
+    Finding &field(const std::string &key, const std::string &text, bool isNumber, bool isPrinted,
+                   bool isList = false, bool isBool = false);
+
+    template <typename T>
+    Finding &list(const std::string &key, const std::vector<T> &values, bool isPrinted)
+    {
+        static_assert(std::is_arithmetic<T>::value, "lists hold numbers");
+        std::ostringstream text;
+        for (size_t i = 0; i < values.size(); i++)
+            text << (i ? "/" : "") << values[i];
+        return field(key, text.str(), true, isPrinted, true);
+    }
+};
+
+// findings.ndjson in the output directory, flushed after every object and
+// appended to when append is set (a resumed run); false if it could not be
+// opened or another caller already holds it open
+bool openFindingReport(const std::string &path, const Rank *ranks, int numRanks, bool append = false);
+// {"type":"summary","iteration":N,"hang":..,"analysisSeconds":..,
+// "findings":{type: count}} over the findings since the previous summary
+void reportIterationSummary(int iteration, bool isHang, double analysisSeconds);
+void closeFindingReport();
+#endif
@@ -0,0 +1,15 @@
+#ifndef CONFIG_GANTT_CHART
+#define CONFIG_GANTT_CHART
+#include <string>
+#include <vector>
+#include "GraphNode.hpp"
+
+// Renders one PP group's iteration as an SVG Gantt chart: a row per stage,
+// time on the X axis, one bar per F/B process (and DP gradient sync), from
+// the node start/end times. Slow nodes are orange, hang nodes red and run
+// to the end of the chart, critical-path nodes have a dark outline.
+void writeGantt(const Graph &graph, const std::string &outputFileName, int ppSize);
+
+// Renders graphs[i] to paths[i] + ".svg" on up to hardware_concurrency threads
+void writeGantts(const std::vector<Graph> &graphs, const std::vector<std::string> &paths, int ppSize);
+#endif
@@ -4,20 +4,26 @@
 #include <vector>
 #include <unordered_map>
 #include <map>
+#include <set>
 #include "Rank.hpp"
 #include "LogParser.hpp"
+#include "OpSequence.hpp"
 
+// [batch][sublayer][tp] timestamps of the SP AllGather/ReduceScatter of
+// each sublayer; sublayer 0 is unused so indices match TP_Rank_info
 struct TP_Rank_SP_info
 {
-    std::vector<std::vector<double>> Rank_FW_ag_time;
-    std::vector<std::vector<double>> Rank_FW_rs_time;
-    std::vector<std::vector<double>> Rank_BW_ag1_time;
-    std::vector<std::vector<double>> Rank_BW_ag2_time;
-    std::vector<std::vector<double>> Rank_BW_rs_time;
+    std::vector<std::vector<std::vector<double>>> Rank_FW_ag_time;
+    std::vector<std::vector<std::vector<double>>> Rank_FW_rs_time;
+    std::vector<std::vector<std::vector<double>>> Rank_BW_ag1_time;
+    std::vector<std::vector<std::vector<double>>> Rank_BW_ag2_time;
+    std::vector<std::vector<std::vector<double>>> Rank_BW_rs_time;
 
-    TP_Rank_SP_info(int batch_size, int tp_index);
+    TP_Rank_SP_info(int batch_size, int layer, int tp_index);
 };
 
+// [batch][sublayer][tp]: index 0 is the process start, index k the end of
+// the k-th sublayer (two per layer: attention and MLP)
 struct TP_Rank_info
 {
     std::vector<std::vector<std::vector<double>>> Rank_FW_time;
@@ -34,6 +40,28 @@ struct DP_Rank_info
     DP_Rank_info(int dp_size);
 };
 
+// One MoE all-to-all of an F/B process: a run of grouped Send/Recv records.
+// In F the dispatch comes before the combine, in B their gradients run the
+// other way round.
+struct AllToAllBurst
+{
+    std::string process;
+    int ordinal;   // among the bursts of the process
+    bool dispatch; // the token dispatch (or its gradient), else the combine
+    double start;  // first record of the burst
+    double end;    // first record after it
+    long long bytesSent;
+    long long bytesRecv;
+};
+
+// [ep]: the bursts of each member of an EP group, in log order
+struct EP_Rank_info
+{
+    std::vector<std::vector<AllToAllBurst>> bursts;
+
+    EP_Rank_info(int ep_size);
+};
+
 struct Node
 {
     Rank rank;
@@ -45,6 +73,11 @@ struct Node
     double duration;
     double startTime;
     double endTime;
+    double recvTime; // PP Recv posted before the process, 0 if none
+    double sendTime; // PP Send posted after the process, 0 if none
+    double expected;   // baseline duration a slow node was judged against
+    double slack;      // latest minus earliest start on the critical path
+    double confidence; // how far beyond the slow threshold, 0..1
     bool isCriticalNode;
     bool isSlowNode;
     bool isHangNode;
@@ -71,26 +104,75 @@ struct Iteration
 {
     int iter;
     std::vector<TP_Rank_info> TP_info;
+    std::vector<TP_Rank_SP_info> TP_SP_info;
     std::vector<PP_Rank_info> PP_info;
     std::vector<DP_Rank_info> DP_info;
+    std::vector<EP_Rank_info> EP_info;
     std::vector<std::vector<NCCLLog>> historyLogs;
+    std::vector<std::unordered_map<std::string, OpSequence>> opSequences;
 
-    Iteration(int iter_val, int TP_group_size, int PP_group_size, int DP_group_size,
-              int batch_size, int layer, int tp_size, int pp_size, int dp_size, int numRank);
+    Iteration(int iter_val, int TP_group_size, int PP_group_size, int DP_group_size, int EP_group_size,
+              int batch_size, int layer, int tp_size, int pp_size, int dp_size, int ep_size, int numRank, bool isSP);
 };
 
+// Expected F/B process duration per (ppIndex, batchIndex), shared by all PP
+// groups. The estimator is "mean" (running mean), "ewma" (decay alpha) or
+// "median" (median/MAD over the last samples); a cell judges durations once
+// it holds samples from warmup iterations, possibly loaded from a previous
+// run. Every PP group adds a sample per iteration, so data_num alone would
+// make a cell ready partway through the second iteration.
 struct PPTimeTable
 {
     int ppGroup;
+    std::string estimator;
+    double alpha;
+    int warmup;
+    double madThreshold;
+    std::set<int> excluded;
     std::vector<std::vector<double>> expectation;
     std::vector<std::vector<int>> data_num;
+    std::vector<std::vector<int>> iteration_num;
+    std::vector<std::vector<int>> last_iteration;
+    std::vector<std::vector<std::vector<double>>> samples;
     PPTimeTable(int pp_size, int batch_num);
 
+    PPTimeTable(int pp_size, int batch_num, const TrainingConfig &config);
+
     PPTimeTable();
 
+    bool isExcluded(int iterationNum) const;
+
+    bool isReady(int ppIndex, int batchIndex) const;
+
     bool isSlow(int ppIndex, int batchIndex, double timeCost, double threshold);
 
     void updateTimeTable(int ppIndex, int batchIndex, double timeCost, int iterationNum);
+
+    // text format: a model line, then one line per cell; load() rejects a
+    // file written for another model
+    bool save(const std::string &path, const std::string &model) const;
+
+    bool load(const std::string &path, const std::string &model);
+};
+
+// identifies runs whose baselines are interchangeable
+std::string modelKey(const TrainingConfig &config);
+
+// A slow node reported by Graph::checkSlow, kept for correlation with
+// other data sources (e.g. telemetry link windows).
+struct SlowRecord
+{
+    int rank;
+    int iteration;
+    std::string processID;
+    std::string ncclFunction;
+    double latency;
+    double startTime;
+    double endTime;
+    bool isCritical;
+
+    SlowRecord(int rank, int iteration, const std::string &processID, const std::string &ncclFunction,
+               double latency, double startTime, double endTime, bool isCritical);
 };
 
 struct Graph
@@ -116,7 +198,9 @@ struct Graph
 
     void graphVisualization(std::string &outputFileName);
 
-    bool buildComputationGraph(double threshold, PP_Rank_info pp_rank_info, std::vector<DP_Rank_info> dp_Info, std::vector<std::vector<NCCLLog>> historyLogs, PPTimeTable &timetable, int expectNodeNum);
+    // vpSize > 1: the stages ran the interleaved schedule, dependencies
+    // follow the virtual stage and microbatch in the process names
+    bool buildComputationGraph(double threshold, PP_Rank_info pp_rank_info, std::vector<DP_Rank_info> dp_Info, std::vector<std::vector<NCCLLog>> historyLogs, PPTimeTable &timetable, int expectNodeNum, int vpSize = 1);
 
     std::string incrementNodeID(const std::string &nodeID);
 
@@ -124,7 +208,9 @@ struct Graph
 
     void calculateCriticalPath();
 
-    void checkSlow(std::vector<std::vector<NCCLLog>> historyLogs);
+    std::vector<SlowRecord> checkSlow(std::vector<std::vector<NCCLLog>> historyLogs);
 };
 
+const std::vector<SlowRecord> &getSlowRecords();
+
 #endif
\ No newline at end of file
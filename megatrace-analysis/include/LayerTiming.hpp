@@ -0,0 +1,24 @@
+#ifndef CONFIG_LAYER_TIMING
+#define CONFIG_LAYER_TIMING
+#include <vector>
+#include <set>
+#include <fstream>
+#include "Config.hpp"
+#include "GraphNode.hpp"
+
+// Fills TP_info (and TP_SP_info in SP mode) of one rank from the records of
+// a finished F/B process, logs[startIdx - 1 .. endIdx - 1]. Sublayer ends are
+// the TP AllReduces (SP: ReduceScatters) on the process's busiest stream.
+// With model chunks each (microbatch, chunk) has its own row.
+void fillLayerTiming(Iteration &iteration, const Rank &rank, const TrainingProcess &process,
+                     const std::vector<NCCLLog> &logs, const TrainingConfig &config);
+
+void writeLayerHeader(std::ofstream &outFile);
+
+// Compares each rank's per-layer intervals with its TP peers and reports the
+// layers, and the GPUs, that are slower in most microbatches and on average
+// by more than layerMinExcess. Excluded (checkpoint, eval) iterations are
+// not reported.
+void reportLayerTiming(std::ofstream &outFile, const Iteration &iteration, Rank *ranks,
+                       const TrainingConfig &config, const std::set<int> &excluded);
+#endif
@@ -0,0 +1,62 @@
+#ifndef CONFIG_LINK_MATRIX
+#define CONFIG_LINK_MATRIX
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+#include <tuple>
+#include "Config.hpp"
+#include "Telemetry.hpp"
+
+// Traffic of one (srcIP, dstIP) link inside one time window
+struct LinkStat
+{
+    long long requests;
+    long long bytes;
+    double busyTime;
+    double maxLatency;
+
+    LinkStat();
+
+    void add(const TelemetryRecord &record);
+    void merge(const LinkStat &other);
+    double gbps() const;
+    double avgLatency() const;
+};
+
+// (window index, srcIP, dstIP)
+typedef std::tuple<long, std::string, std::string> LinkKey;
+// (group, func, funcTimes)
+typedef std::tuple<std::string, int, unsigned long long> FlowKey;
+
+struct LinkMatrix
+{
+    double window;
+    std::map<LinkKey, LinkStat> links;
+    std::map<FlowKey, std::set<std::pair<int, int>>> flows;
+    // (commHash, comm rank) -> source IPs the rank sent from
+    std::map<std::pair<std::string, int>, std::set<std::string>> rankIPs;
+
+    LinkMatrix(double window);
+
+    void add(const TelemetryRecord &record);
+    void merge(const LinkMatrix &other);
+};
+
+struct SlowLink
+{
+    long windowIndex;
+    std::string srcIP;
+    std::string dstIP;
+    double gbps;
+    double median;
+
+    SlowLink(long windowIndex, const std::string &srcIP, const std::string &dstIP, double gbps, double median);
+};
+
+std::vector<std::vector<int>> findCycles(const std::set<std::pair<int, int>> &edges);
+
+std::vector<SlowLink> findSlowLinks(const LinkMatrix &matrix, double ratio);
+
+int runTelemetryAnalysis(const std::string &telemetryDir, TrainingConfig &config);
+#endif
@@ -0,0 +1,59 @@
+#ifndef CONFIG_LIVE_MONITOR
+#define CONFIG_LIVE_MONITOR
+#include <string>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+#include <unordered_map>
+#include "Config.hpp"
+#include "Rank.hpp"
+#include "LogParser.hpp"
+
+// Records one rank issued on one stream (or comm hash) since the log began;
+// lastIndex and lastReduceScatter count the rank's records, like the indices
+// of an OpSequence
+struct StreamProgress
+{
+    uint64_t seq;
+    NCCLLog last;
+    uint64_t lastIndex;
+    bool reduceScatter;
+    uint64_t lastReduceScatter;
+    bool p2p;
+
+    StreamProgress();
+};
+
+struct RankProgress
+{
+    std::mutex lock;
+    double lastTime;
+    uint64_t records;
+    std::unordered_map<std::string, StreamProgress> streams;
+
+    RankProgress();
+};
+
+// Live-tail state shared by the workers and the watchdog. Workers report
+// every record in O(1); the watchdog declares a hang when no rank produced a
+// record for deadline seconds, writes the snapshot and stops the workers.
+struct LiveMonitor
+{
+    double deadline;
+    std::vector<RankProgress> ranks;
+    std::atomic<uint64_t> records;
+    std::atomic<bool> stop;
+
+    LiveMonitor(int numRanks, double deadline);
+
+    void record(int rank, const NCCLLog &log);
+
+    // returns once the deadline expired or all numRanks workers terminated
+    void watch(const TrainingConfig &config, Rank *rankInfo, const std::atomic<int> &terminated);
+
+    // per group: the highest collective sequence number any member reached,
+    // the members inside it and the members that never arrived
+    void snapshot(const TrainingConfig &config, Rank *rankInfo);
+};
+#endif
@@ -10,11 +10,13 @@ struct NCCLLog
     std::string streamID;
     double latency;
     int rankID;
-    int size;
+    long long size;
     int iteration;
     std::string ncclFunction;
     std::string process;
-    NCCLLog(double ts, std::string &sid, double lat, int rank, int sz, int iter, const std::string &func, const std::string &proc);
+    std::string commHash;
+    unsigned long long opCount;
+    NCCLLog(double ts, std::string &sid, double lat, int rank, long long sz, int iter, const std::string &func, const std::string &proc);
 
     NCCLLog();
 };
@@ -23,6 +25,8 @@ int fetchLog(const std::string &filePath, std::streampos &lastPosition, NCCLLog
 
 int parseLogs(const std::vector<std::string> &logs);
 
+int parseLogs(const std::vector<std::string> &logs, std::vector<NCCLLog> &parsedLogs);
+
 NCCLLog parseLog(const std::string &log);
 
 std::unordered_map<std::string, std::vector<NCCLLog>> groupLogsByStream(const std::vector<NCCLLog> &logs);
@@ -47,5 +51,9 @@ void worker_withoutSP(const std::string& filePath, int workerID,
 void worker_withSP(const std::string& filePath, int workerID, 
                     Rank rank, const TrainingConfig& config, 
                     std::vector<TrainingProcess> trainingPattern);
-void manager(const TrainingConfig& config);
+void manager(const TrainingConfig& config, Rank *ranks);
+
+// commHash -> global ranks that issued on it during the last initParser,
+// sorted, so position i is comm rank i
+std::unordered_map<std::string, std::vector<int>> getCommMembers();
 #endif
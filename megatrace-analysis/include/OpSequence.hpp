@@ -0,0 +1,53 @@
+#ifndef CONFIG_OP_SEQUENCE
+#define CONFIG_OP_SEQUENCE
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <unordered_map>
+#include "LogParser.hpp"
+#include "Rank.hpp"
+
+// Rolling hash of the (function, comm, size) sequence one rank issued on one
+// communicator in one iteration; prefix[k] covers the first k + 1 records and
+// index[k] is the position of record k in the rank's historyLogs. The last
+// ReduceScatter is kept so the stream's group is known without a rescan.
+struct OpSequence
+{
+    std::vector<uint64_t> prefix;
+    std::vector<size_t> index;
+    bool hasReduceScatter;
+    size_t lastReduceScatter;
+
+    OpSequence();
+
+    void add(const NCCLLog &log, size_t logIndex);
+};
+
+// the comm hash, or the stream for records without one
+std::string sequenceKey(const NCCLLog &log);
+
+// First record where one rank left the sequence of its group
+struct Divergence
+{
+    int rank;
+    int peer;
+    std::string comm;
+    size_t position;
+    std::string function;     // record of rank at position, "none" past its end
+    std::string peerFunction; // record of peer at position
+
+    Divergence();
+};
+
+// Compares the sequences of every communicator's members: the reference is
+// the longest member among the majority at the common length; a member whose
+// hash differs over their common length is binary searched for the first
+// diverging position, so an iteration costs O(sequences) plus O(log n) per
+// diverging rank. A member that agrees but stopped short diverges at its
+// length, with function "none". Streams are mapped to TP/DP groups as in collective-skew,
+// from the sequences' counts rather than the records.
+std::vector<Divergence> findDivergence(const std::vector<std::unordered_map<std::string, OpSequence>> &opSequences,
+                                       const std::vector<std::vector<NCCLLog>> &historyLogs, Rank *ranks, int numRanks);
+
+void reportDivergence(const std::vector<Divergence> &divergences, int iteration);
+#endif
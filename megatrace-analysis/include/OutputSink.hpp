@@ -0,0 +1,63 @@
+#ifndef CONFIG_OUTPUT_SINK
+#define CONFIG_OUTPUT_SINK
+#include <string>
+#include <vector>
+#include <mutex>
+#include <fstream>
+#include <cstdint>
+
+// Destination of the per-rank logs, graphs and charts: one loose file per
+// entry, or one packed archive. write() takes the path the file would have
+// and the complete content; it is safe to call from any thread.
+class OutputSink
+{
+public:
+    virtual ~OutputSink();
+    virtual bool write(const std::string &path, const std::string &data) = 0;
+    virtual void close();
+};
+
+class FileSink : public OutputSink
+{
+public:
+    bool write(const std::string &path, const std::string &data) override;
+};
+
+// <dir>/output.mta: "MTA1", version, index offset, then the entry sections
+// and an index of (name, offset, stored size, raw size, codec). Entries are
+// named by their path relative to dir; sections are zlib-compressed when
+// built with zlib and compress is set.
+class ArchiveSink : public OutputSink
+{
+public:
+    ArchiveSink(const std::string &dir, bool compress);
+    ~ArchiveSink();
+    bool is_open() const;
+    bool write(const std::string &path, const std::string &data) override;
+    // writes the index; no entry can be added afterwards
+    void close() override;
+
+private:
+    struct Entry
+    {
+        std::string name;
+        uint64_t offset;
+        uint64_t storedSize;
+        uint64_t rawSize;
+        uint8_t codec;
+    };
+    std::string prefix;
+    bool compressSections;
+    std::mutex mtx;
+    std::ofstream out;
+    std::vector<Entry> entries;
+};
+
+// The sink every writer uses; loose files unless another one is installed
+OutputSink &getOutputSink();
+// takes ownership; nullptr restores loose files
+void setOutputSink(OutputSink *sink);
+
+// Trace cat <output.mta> [<entry>]: lists the entries, or writes one to stdout
+int runCat(const std::string &archivePath, const std::string &entry);
+#endif
@@ -0,0 +1,19 @@
+#ifndef CONFIG_PATTERN_LEARNER
+#define CONFIG_PATTERN_LEARNER
+#include <vector>
+#include "Config.hpp"
+#include "Rank.hpp"
+#include "TraceStore.hpp"
+
+// gen_training_pattern with each stage's record counts learned from the
+// first iterations of one of its ranks. The (function, size) sequence is
+// periodic per iteration after the warmup records; the period comes from
+// the Z-function of the reversed sequence, and the F/B sizes, the tail and
+// the start of the first iteration from where the PP send/recv of one
+// period fall; grouped Send/Recv runs are MoE all-to-alls, not PP markers.
+// A stage that cannot be learned keeps the hand-written counts; where no
+// send/recv separates F from B, the records beyond the hand-written ones
+// are split evenly between them. Interleaved schedules (vpSize > 1) always
+// use the hand-written counts.
+std::vector<std::vector<TrainingProcess>> learnTrainingPattern(const TrainingConfig &config, const Rank *ranks, TraceStore *store);
+#endif
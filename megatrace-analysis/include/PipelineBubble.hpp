@@ -0,0 +1,38 @@
+#ifndef CONFIG_PIPELINE_BUBBLE
+#define CONFIG_PIPELINE_BUBBLE
+#include <vector>
+#include <fstream>
+#include "GraphNode.hpp"
+
+// Time accounting of one PP stage over one iteration
+struct StageBubble
+{
+    int stage;
+    int microbatches;
+    double busy;     // F/B process time, Recv to Send, minus recvWait
+    double idle;     // pipeline span minus busy
+    double recvWait; // time the stage's Recv was posted before its producer's Send
+
+    StageBubble(int stage);
+};
+
+struct PipelineBubble
+{
+    int ppGroup;
+    double span;
+    double bubbleFraction;
+    int bottleneck;
+    std::vector<StageBubble> stages;
+
+    PipelineBubble(int ppGroup, int ppSize);
+};
+
+// Pairs each virtual stage's Send with the next one's Recv per microbatch
+// (forward: v -> v+1, backward: v+1 -> v) and splits the pipeline span of
+// one PP group into busy, idle and recv-wait time per stage.
+PipelineBubble analyzePipeline(const PP_Rank_info &ppInfo, int ppGroup, int ppSize, int vpSize);
+
+void writeBubbleHeader(std::ofstream &outFile);
+
+void reportBubble(std::ofstream &outFile, const std::vector<PipelineBubble> &bubbles, int iteration);
+#endif
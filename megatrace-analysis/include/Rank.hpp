@@ -11,6 +11,8 @@ public:
   int pp_group;
   int dp;
   int dp_group;
+  int ep;
+  int ep_group;
   int n_rank;
   int next_pp;
   bool is_first_pp;
@@ -20,7 +22,7 @@ public:
        int dp = 0, int dp_group = 0, int n_rank = 0,
        bool is_first_pp = false, bool is_last_pp = false)
       : id(id), tp(tp), tp_group(tp_group), pp(pp), pp_group(pp_group),
-        dp(dp), dp_group(dp_group), n_rank(n_rank),
+        dp(dp), dp_group(dp_group), ep(0), ep_group(0), n_rank(n_rank),
         is_first_pp(is_first_pp), is_last_pp(is_last_pp) {}
 
   ~Rank() {}
@@ -31,6 +33,8 @@ public:
   int getPpGroup() const { return pp_group; }
   int getDp() const { return dp; }
   int getDpGroup() const { return dp_group; }
+  int getEp() const { return ep; }
+  int getEpGroup() const { return ep_group; }
   int getNRank() const { return n_rank; }
   bool getIsFirstPp() const { return is_first_pp; }
   bool getIsLastPp() const { return is_last_pp; }
@@ -41,6 +45,8 @@ public:
   void setPpGroup(int value) { pp_group = value; }
   void setDp(int value) { dp = value; }
   void setDpGroup(int value) { dp_group = value; }
+  void setEp(int value) { ep = value; }
+  void setEpGroup(int value) { ep_group = value; }
   void setNRank(int value) { n_rank = value; }
   void setIsFirstPp(bool value) { is_first_pp = value; }
   void setIsLastPp(bool value) { is_last_pp = value; }
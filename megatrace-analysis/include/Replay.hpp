@@ -0,0 +1,39 @@
+#ifndef CONFIG_REPLAY
+#define CONFIG_REPLAY
+#include <string>
+#include <vector>
+#include <fstream>
+#include <set>
+#include "GraphNode.hpp"
+
+// CSR copy of one iteration's computation graph in topological order. A node
+// starts its delay after the last of its predecessors ends (roots at their
+// measured offset), so replaying the measured durations gives the measured
+// makespan and replaying baseline durations answers "what if".
+struct ReplayGraph
+{
+    std::vector<std::string> ids;
+    std::vector<int> ranks;
+    std::vector<bool> slow;
+    std::vector<double> duration;
+    std::vector<double> baseline;
+    std::vector<double> delay;
+    std::vector<int> offsets; // successors of i: targets[offsets[i] .. offsets[i + 1])
+    std::vector<int> targets;
+    double measured;
+
+    ReplayGraph(const Graph &graph, const PPTimeTable &timetable);
+
+    // O(V + E) pass; durations are indexed like ids
+    double makespan(const std::vector<double> &durations) const;
+
+    // makespan with the given nodes at their baseline duration
+    double whatIf(const std::vector<int> &nodes) const;
+};
+
+void writeWhatIfHeader(std::ofstream &outFile);
+
+// Batch mode: every slow node, every rank owning one and every rank in
+// ranks is replayed at baseline and ranked by recoverable time.
+void reportWhatIf(std::ofstream &outFile, const ReplayGraph &replay, int iteration, int groupID, const std::set<int> &ranks);
+#endif
@@ -0,0 +1,66 @@
+#ifndef CONFIG_TELEMETRY
+#define CONFIG_TELEMETRY
+#include <string>
+#include <vector>
+#include <fstream>
+#include <unordered_map>
+#include <functional>
+#include "LogParser.hpp"
+
+// One row of the VCCL per-NIC/port telemetry CSV (<host>_<nic>_Port<d>_A/B.log).
+// FromRank/ToRank are comm-local ranks; times are seconds with the same
+// 1735689600 offset the Megatrace records use.
+struct TelemetryRecord
+{
+    std::string host;
+    std::string nic;
+    int port;
+    int devIndex;
+    int fromRank;
+    int toRank;
+    int func;
+    unsigned long long funcTimes;
+    std::string srcIP;
+    std::string dstIP;
+    int bandwidth;
+    double startTime;
+    double endTime;
+    long long bytes;
+    std::string commHash;
+    std::string groupHash;
+
+    TelemetryRecord();
+};
+
+// Records of a telemetry directory, indexed by (commHash, op count) so they
+// can be joined with the Megatrace record of the same collective.
+struct TelemetryIndex
+{
+    std::vector<TelemetryRecord> records;
+    std::unordered_map<std::string, std::vector<size_t>> byCollective;
+
+    void add(const TelemetryRecord &record);
+    const std::vector<size_t> *find(const std::string &commHash, unsigned long long opCount) const;
+};
+
+std::string collectiveKey(const std::string &commHash, unsigned long long opCount);
+
+int parseTelemetryFile(const std::string &filePath, std::vector<TelemetryRecord> &records);
+
+std::vector<std::string> listTelemetryFiles(const std::string &dirPath);
+
+// Parses files on all hardware threads; consume(threadID, records) is called
+// once per file from the parsing thread.
+void parseTelemetryFiles(const std::vector<std::string> &files,
+                         const std::function<void(int, std::vector<TelemetryRecord> &)> &consume);
+
+int loadTelemetry(const std::string &dirPath, TelemetryIndex &index);
+
+// comm-local rank r is the r-th smallest global rank that logged the comm
+std::unordered_map<std::string, std::vector<int>> commMembers(const std::vector<std::vector<NCCLLog>> &historyLogs);
+
+void writeBreakdownHeader(std::ofstream &outFile);
+
+void writeCollectiveBreakdown(std::ofstream &outFile, const TelemetryIndex &index,
+                              const std::vector<std::vector<NCCLLog>> &historyLogs, int iteration);
+#endif
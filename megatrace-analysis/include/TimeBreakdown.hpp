@@ -0,0 +1,30 @@
+#ifndef CONFIG_TIME_BREAKDOWN
+#define CONFIG_TIME_BREAKDOWN
+#include <vector>
+#include <fstream>
+#include "Rank.hpp"
+#include "LogParser.hpp"
+
+// Where one rank spent the gaps between its records over one iteration
+struct RankBreakdown
+{
+    int stage;
+    double compute;   // GPU work between two records
+    double commWait;  // waiting for collective peers or a P2P Recv
+    double hostStall; // launch gaps on a stream switch beyond the stage's peers
+    int intervals;
+
+    RankBreakdown();
+};
+
+// Classifies every inter-record interval of every rank. The part before the
+// last member arrived at the rank's collective is communication wait, as is
+// the interval after a Recv; the rest is compute, except that a gap switching
+// streams which is longer than the median of the same interval on the other
+// ranks of the stage counts the excess as host stall.
+std::vector<RankBreakdown> breakdownTime(const std::vector<std::vector<NCCLLog>> &historyLogs, Rank *ranks, int numRanks);
+
+void writeTimeHeader(std::ofstream &outFile);
+
+void reportTime(std::ofstream &outFile, const std::vector<RankBreakdown> &breakdowns, int iteration, int ppSize);
+#endif
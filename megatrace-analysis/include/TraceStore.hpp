@@ -0,0 +1,74 @@
+#ifndef CONFIG_TRACE_STORE
+#define CONFIG_TRACE_STORE
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <fstream>
+#include "Config.hpp"
+#include "LogParser.hpp"
+
+// On-disk layout of a .mtc store: header, string table, per-rank columns,
+// rank directory. All offsets are from the start of the file and 8-byte
+// aligned so the columns can be read in place from the mapping.
+struct MtcHeader
+{
+    char magic[4];
+    uint32_t version;
+    uint32_t numRanks;
+    uint32_t numStrings;
+    uint64_t stringOffset; // uint64 offsets[numStrings + 1], then the characters
+    uint64_t rankOffset;   // MtcRank[numRanks]
+};
+
+struct MtcIterationIndex
+{
+    uint64_t record; // first record of the iteration's first F/B process
+    int64_t timeNs;  // its absolute timestamp, an anchor for the deltas
+};
+
+struct MtcRank
+{
+    uint64_t records;
+    int64_t baseNs;          // absolute timestamp of record 0
+    uint64_t timeOffset;     // int64 delta to the previous record, ns
+    uint64_t functionOffset; // uint32 string id
+    uint64_t streamOffset;   // uint32 string id
+    uint64_t commOffset;     // uint32 string id, 0 ("") for v3 records
+    uint64_t opOffset;       // uint64
+    uint64_t sizeOffset;     // int64
+    uint64_t iterations;
+    uint64_t iterationOffset; // MtcIterationIndex[iterations]
+};
+
+// Read-only mapping of a .mtc store. Each rank keeps its own decode cursor,
+// so one worker thread per rank may fetch concurrently.
+class TraceStore
+{
+public:
+    TraceStore();
+    ~TraceStore();
+
+    bool open(const std::string &path);
+    int numRanks() const;
+    size_t records(int rank) const;
+    // record index of the first F/B process of iteration (1-based), or the
+    // record count when the rank stopped before it
+    size_t iterationStart(int rank, int iteration) const;
+    // fills log with record index of rank; -1 past the end
+    int fetch(int rank, size_t index, NCCLLog &log);
+
+private:
+    const char *base;
+    size_t length;
+    const MtcHeader *header;
+    const MtcRank *ranks;
+    std::vector<std::string> strings;
+    std::vector<size_t> cursorIndex;
+    std::vector<int64_t> cursorNs;
+
+    int64_t timeAt(int rank, size_t index);
+};
+
+// Trace convert <log_dir> <store.mtc>: parses every rank_N.log once
+int runConvert(const std::string &logDir, const std::string &storePath, TrainingConfig &config);
+#endif
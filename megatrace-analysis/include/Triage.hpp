@@ -0,0 +1,29 @@
+#ifndef CONFIG_TRIAGE
+#define CONFIG_TRIAGE
+#include <vector>
+#include <string>
+#include "Config.hpp"
+#include "Rank.hpp"
+#include "TraceStore.hpp"
+
+// One PP group in one iteration, from boundary records only: the busy span
+// of a rank runs from the start of its first F/B process to the end of its
+// last one, so time a fast group spends waiting in the DP sync is left out.
+struct GroupSpan
+{
+    int ppGroup;
+    size_t iteration;
+    double busy;   // longest busy span of the group's ranks
+    double spread; // longest minus shortest
+    double ratio;  // busy over the median busy of all groups
+    bool stopped;  // a rank's log ends inside the iteration
+};
+
+// Reads the first and last F/B record of every iteration of every rank (the
+// store's iteration index, or a line count over the raw log), writes
+// triage.csv and returns the PP groups to analyse in full: the topK groups
+// with the largest ratio over the non-excluded iterations, stopped groups
+// first.
+std::vector<int> triageGroups(const TrainingConfig &config, Rank *ranks, TraceStore *store,
+                              const std::vector<std::vector<TrainingProcess>> &trainingPatterns);
+#endif
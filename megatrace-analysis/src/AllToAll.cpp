@@ -0,0 +1,184 @@
+#include "AllToAll.hpp"
+#include "Findings.hpp"
+#include <iomanip>
+#include <algorithm>
+
+static bool isP2P(const std::string &ncclFunction)
+{
+    return ncclFunction == "ncclSend" || ncclFunction == "ncclRecv";
+}
+
+bool isAllToAll(int sends, int recvs)
+{
+    return sends >= 2 && recvs >= 2;
+}
+
+void fillAllToAll(Iteration &iteration, const Rank &rank, const TrainingProcess &process,
+                  const std::vector<NCCLLog> &logs)
+{
+    if (iteration.EP_info.empty() || process.startIdx < 1 || process.endIdx > logs.size())
+        return;
+    std::vector<AllToAllBurst> &bursts = iteration.EP_info[rank.getEpGroup()].bursts[rank.getEp()];
+    int epSize = iteration.EP_info[rank.getEpGroup()].bursts.size();
+    bool isForward = process.name.find('F') != std::string::npos;
+    int ordinal = 0;
+    auto add = [&](size_t first, size_t next, long long sent, long long received)
+    {
+        // the record after the burst, not read yet when it ends the process
+        double end = logs[std::min(next, logs.size() - 1)].timestamp;
+        bool dispatch = (ordinal % 2 == 0) == isForward;
+        bursts.push_back({process.name, ordinal, dispatch, logs[first].timestamp, end, sent, received});
+        ordinal++;
+    };
+    size_t i = process.startIdx - 1;
+    while (i < process.endIdx)
+    {
+        size_t j = i;
+        int sends = 0, recvs = 0;
+        for (; j < process.endIdx && isP2P(logs[j].ncclFunction); j++)
+            (logs[j].ncclFunction == "ncclSend" ? sends : recvs)++;
+        if (isAllToAll(sends, recvs))
+        {
+            // back-to-back all-to-alls (a dispatch and a combine with no TP
+            // collective in between) are cut after one Send and one Recv per
+            // EP rank, self included, as all_to_all_single issues them
+            bool split = sends == recvs && sends % epSize == 0;
+            size_t first = i;
+            int burstSends = 0, burstRecvs = 0;
+            long long sent = 0, received = 0;
+            for (size_t r = i; r < j; r++)
+            {
+                bool isSend = logs[r].ncclFunction == "ncclSend";
+                (isSend ? burstSends : burstRecvs)++;
+                (isSend ? sent : received) += logs[r].size;
+                if (r + 1 == j || (split && burstSends == epSize && burstRecvs == epSize))
+                {
+                    add(first, r + 1, sent, received);
+                    first = r + 1;
+                    burstSends = burstRecvs = 0;
+                    sent = received = 0;
+                }
+            }
+        }
+        i = std::max(j, i + 1);
+    }
+}
+
+void writeAllToAllHeader(std::ofstream &outFile)
+{
+    outFile << "Iteration,EPGroup,Rank,Phase,Bursts,Time,LateCount,WaitCaused,BytesRecv,TokenShare" << std::endl;
+}
+
+struct PhaseStats
+{
+    int count;
+    int late;
+    double time;
+    double waitCaused;
+    long long bytesRecv;
+};
+
+void reportAllToAll(std::ofstream &outFile, const Iteration &iteration, Rank *ranks, const TrainingConfig &config)
+{
+    int epSize = config.epSize;
+    if (epSize < 2 || iteration.EP_info.empty())
+        return;
+
+    // EP group -> global rank of every EP index
+    std::vector<std::vector<int>> groupRanks(iteration.EP_info.size(), std::vector<int>(epSize, -1));
+    for (int i = 0; i < config.numRanks; i++)
+        if (ranks[i].getEpGroup() < (int)groupRanks.size() && ranks[i].getEp() < epSize)
+            groupRanks[ranks[i].getEpGroup()][ranks[i].getEp()] = i;
+
+    const char *phaseNames[2] = {"dispatch", "combine"};
+    outFile << std::fixed << std::setprecision(6);
+    for (size_t g = 0; g < iteration.EP_info.size(); g++)
+    {
+        const std::vector<std::vector<AllToAllBurst>> &bursts = iteration.EP_info[g].bursts;
+        size_t matched = bursts[0].size();
+        for (int e = 1; e < epSize; e++)
+            matched = std::min(matched, bursts[e].size());
+
+        // [phase][ep]
+        std::vector<std::vector<PhaseStats>> stats(2, std::vector<PhaseStats>(epSize, PhaseStats{0, 0, 0, 0, 0}));
+        std::vector<long long> expertBytes(epSize, 0);
+        long long totalExpertBytes = 0;
+        double totalTime = 0;
+        size_t k = 0;
+        for (; k < matched; k++)
+        {
+            const AllToAllBurst &head = bursts[0][k];
+            bool lined = true;
+            for (int e = 1; e < epSize && lined; e++)
+                lined = bursts[e][k].process == head.process && bursts[e][k].ordinal == head.ordinal;
+            // a member skipped a burst: the later ones no longer line up
+            if (!lined)
+                break;
+            int phase = head.dispatch ? 0 : 1;
+            int lastEp = 0;
+            for (int e = 0; e < epSize; e++)
+            {
+                const AllToAllBurst &burst = bursts[e][k];
+                PhaseStats &stat = stats[phase][e];
+                stat.count++;
+                stat.time += burst.end - burst.start;
+                stat.bytesRecv += burst.bytesRecv;
+                totalTime += burst.end - burst.start;
+                // the first burst of a pair feeds the experts
+                if (burst.ordinal % 2 == 0)
+                {
+                    expertBytes[e] += burst.bytesRecv;
+                    totalExpertBytes += burst.bytesRecv;
+                }
+                if (burst.start > bursts[lastEp][k].start)
+                    lastEp = e;
+            }
+            double last = bursts[lastEp][k].start;
+            stats[phase][lastEp].late++;
+            for (int e = 0; e < epSize; e++)
+                stats[phase][lastEp].waitCaused += last - bursts[e][k].start;
+        }
+        if (k == 0)
+            continue;
+
+        std::vector<double> share(epSize, 0);
+        for (int e = 0; e < epSize; e++)
+        {
+            int id = groupRanks[g][e];
+            if (id < 0)
+                continue;
+            share[e] = totalExpertBytes > 0 ? (double)expertBytes[e] * epSize / totalExpertBytes : 0;
+            for (int phase = 0; phase < 2; phase++)
+            {
+                const PhaseStats &stat = stats[phase][e];
+                if (stat.count > 0)
+                    outFile << iteration.iter << "," << g << "," << id << "," << phaseNames[phase] << "," << stat.count << ","
+                            << stat.time << "," << stat.late << "," << stat.waitCaused << "," << stat.bytesRecv << ","
+                            << share[e] << std::endl;
+            }
+            if (share[e] >= config.tokenImbalanceRatio)
+                Finding("token-imbalance").rank(id).add("ITERATION", iteration.iter).add("EPGROUP", (int)g)
+                    .add("SHARE", share[e]).data("bytes", expertBytes[e]).emit();
+        }
+
+        // the member the others waited for the most: last in at least half
+        // of the bursts, and kept each of them waiting for alltoallSkewRatio
+        // of a burst on average
+        int straggler = 0;
+        for (int e = 1; e < epSize; e++)
+            if (stats[0][e].waitCaused + stats[1][e].waitCaused > stats[0][straggler].waitCaused + stats[1][straggler].waitCaused)
+                straggler = e;
+        double waited = stats[0][straggler].waitCaused + stats[1][straggler].waitCaused;
+        int late = stats[0][straggler].late + stats[1][straggler].late;
+        double meanBurst = totalTime / (k * epSize);
+        double meanLag = waited / (k * (epSize - 1));
+        if (groupRanks[g][straggler] >= 0 && late * 2 >= (int)k && meanLag >= config.alltoallSkewRatio * meanBurst)
+        {
+            int phase = stats[1][straggler].waitCaused >= stats[0][straggler].waitCaused ? 1 : 0;
+            bool tokens = share[straggler] >= config.tokenImbalanceRatio;
+            Finding("alltoall-straggler").rank(groupRanks[g][straggler]).add("ITERATION", iteration.iter)
+                .add("EPGROUP", (int)g).add("PHASE", phaseNames[phase]).add("WAITED", waited)
+                .add("CAUSE", tokens ? "tokens" : "rank").data("lag", meanLag).data("confidence", (double)late / k).emit();
+        }
+    }
+}
@@ -0,0 +1,88 @@
+#include "Checkpoint.hpp"
+#include "GraphNode.hpp"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+
+Checkpoint::Checkpoint()
+    : nextIteration(1) {}
+
+bool Checkpoint::load(const std::string &path, const TrainingConfig &config)
+{
+    std::ifstream file(path);
+    if (!file.is_open())
+        return false;
+    std::string line, tag;
+    if (!std::getline(file, line) || line != "model " + modelKey(config) ||
+        !std::getline(file, line) || line != "input " + config.inputFilePath)
+    {
+        std::cerr << "Checkpoint " << path << " was written for another model or input, starting cold" << std::endl;
+        return false;
+    }
+    size_t iteration = 0;
+    std::vector<ResumePoint> points(config.numRanks, ResumePoint{0, 0, 0});
+    int found = 0;
+    while (std::getline(file, line))
+    {
+        std::istringstream in(line);
+        in >> tag;
+        int rank;
+        ResumePoint point;
+        if (tag == "iteration")
+            in >> iteration;
+        else if (tag == "rank" && in >> rank >> point.position >> point.pendingRecvTime && rank >= 0 && rank < config.numRanks)
+        {
+            point.iteration = iteration;
+            points[rank] = point;
+            found++;
+        }
+    }
+    if (iteration < 1 || found != config.numRanks)
+    {
+        std::cerr << "Checkpoint " << path << " is incomplete, starting cold" << std::endl;
+        return false;
+    }
+    nextIteration = iteration;
+    ranks = points;
+    return true;
+}
+
+bool Checkpoint::save(const std::string &path, const TrainingConfig &config) const
+{
+    std::ofstream file(path, std::ios::out);
+    if (!file.is_open())
+        return false;
+    file << "model " << modelKey(config) << std::endl;
+    file << "input " << config.inputFilePath << std::endl;
+    file << "iteration " << nextIteration << std::endl;
+    file << std::setprecision(17);
+    for (size_t r = 0; r < ranks.size(); r++)
+        file << "rank " << r << " " << ranks[r].position << " " << ranks[r].pendingRecvTime << std::endl;
+    return file.good();
+}
+
+std::string checkpointBaselinePath(const std::string &path)
+{
+    return path + ".baseline";
+}
+
+std::string checkpointDriftPath(const std::string &path)
+{
+    return path + ".drift";
+}
+
+std::vector<TrainingProcess> resumePattern(const std::vector<TrainingProcess> &pattern, size_t iteration)
+{
+    std::vector<TrainingProcess> rest;
+    size_t base = 0;
+    for (const auto &process : pattern)
+    {
+        if (process.iteration < iteration)
+            continue;
+        if (rest.empty())
+            base = process.startIdx - 1;
+        rest.emplace_back(process.name, process.iteration, process.startIdx - base, process.endIdx - base);
+    }
+    return rest;
+}
@@ -0,0 +1,154 @@
+#include "ChromeTrace.hpp"
+#include <cstdio>
+#include <algorithm>
+#include <limits>
+
+ChromeTraceWriter::ChromeTraceWriter(Rank *ranks, int numRanks)
+    : ranks(ranks),
+      numRanks(numRanks),
+      first(true),
+      origin(-1),
+      tracks(numRanks) {}
+
+ChromeTraceWriter::~ChromeTraceWriter()
+{
+    close();
+}
+
+bool ChromeTraceWriter::open(const std::string &path)
+{
+    out.open(path, std::ios::out);
+    if (!out.is_open())
+        return false;
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    char buffer[256];
+    for (int r = 0; r < numRanks; r++)
+    {
+        snprintf(buffer, sizeof(buffer), "{\"ph\":\"M\",\"name\":\"process_name\",\"pid\":%d,\"args\":{\"name\":\"rank %d (tp %d pp %d dp %d)\"}}",
+                 r, r, ranks[r].getTp(), ranks[r].getPp(), ranks[r].getDp());
+        event(buffer);
+        snprintf(buffer, sizeof(buffer), "{\"ph\":\"M\",\"name\":\"process_sort_index\",\"pid\":%d,\"args\":{\"sort_index\":%d}}", r, r);
+        event(buffer);
+        snprintf(buffer, sizeof(buffer), "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":%d,\"tid\":0,\"args\":{\"name\":\"pipeline\"}}", r);
+        event(buffer);
+    }
+    return true;
+}
+
+bool ChromeTraceWriter::is_open() const
+{
+    return out.is_open();
+}
+
+void ChromeTraceWriter::close()
+{
+    if (!out.is_open())
+        return;
+    out << "\n]}" << std::endl;
+    out.close();
+}
+
+void ChromeTraceWriter::event(const std::string &json)
+{
+    out << (first ? "" : ",\n") << json;
+    first = false;
+}
+
+int ChromeTraceWriter::track(int rank, const std::string &name)
+{
+    auto it = tracks[rank].find(name);
+    if (it != tracks[rank].end())
+        return it->second;
+    int tid = tracks[rank].size() + 1;
+    tracks[rank][name] = tid;
+    char buffer[256];
+    snprintf(buffer, sizeof(buffer), "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":%d,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+             rank, tid, name.c_str());
+    event(buffer);
+    return tid;
+}
+
+// timestamps are seconds; trace events take microseconds
+void ChromeTraceWriter::slice(const std::string &name, const char *category, int pid, int tid, double start, double end, const std::string &args)
+{
+    char buffer[512];
+    snprintf(buffer, sizeof(buffer), "{\"ph\":\"X\",\"name\":\"%s\",\"cat\":\"%s\",\"pid\":%d,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f,\"args\":{%s}}",
+             name.c_str(), category, pid, tid, (start - origin) * 1e6, std::max(0.0, end - start) * 1e6, args.c_str());
+    event(buffer);
+}
+
+void ChromeTraceWriter::instant(const std::string &name, const char *category, int pid, int tid, double time, const std::string &args)
+{
+    char buffer[512];
+    snprintf(buffer, sizeof(buffer), "{\"ph\":\"i\",\"s\":\"t\",\"name\":\"%s\",\"cat\":\"%s\",\"pid\":%d,\"tid\":%d,\"ts\":%.3f,\"args\":{%s}}",
+             name.c_str(), category, pid, tid, (time - origin) * 1e6, args.c_str());
+    event(buffer);
+}
+
+void ChromeTraceWriter::addIteration(const Iteration &iteration, const TelemetryIndex &telemetry)
+{
+    if (!out.is_open())
+        return;
+    if (origin < 0)
+    {
+        origin = std::numeric_limits<double>::max();
+        for (const auto &logs : iteration.historyLogs)
+            if (!logs.empty())
+                origin = std::min(origin, logs.front().timestamp);
+    }
+
+    char args[256];
+    for (int r = 0; r < numRanks && r < (int)iteration.historyLogs.size(); r++)
+    {
+        const std::vector<NCCLLog> &logs = iteration.historyLogs[r];
+        if (logs.empty())
+            continue;
+        snprintf(args, sizeof(args), "\"records\":%zu", logs.size());
+        slice("iteration " + std::to_string(iteration.iter), "iteration", r, 0, logs.front().timestamp, logs.back().timestamp, args);
+        // the logs only hold the host enqueue; the transfer itself is known
+        // only from the telemetry rows this rank sent or received
+        for (const auto &log : logs)
+        {
+            int tid = track(r, log.commHash.empty() ? "stream " + log.streamID : "comm " + log.commHash);
+            bool found = false;
+            double start = 0, end = 0;
+            const std::vector<size_t> *rows = telemetry.records.empty() || log.commHash.empty() ? nullptr : telemetry.find(log.commHash, log.opCount);
+            if (rows != nullptr)
+            {
+                for (size_t row : *rows)
+                {
+                    const TelemetryRecord &record = telemetry.records[row];
+                    if (record.fromRank != r && record.toRank != r)
+                        continue;
+                    start = found ? std::min(start, record.startTime) : record.startTime;
+                    end = found ? std::max(end, record.endTime) : record.endTime;
+                    found = true;
+                }
+            }
+            snprintf(args, sizeof(args), "\"size\":%lld,\"stream\":\"%s\",\"op\":%llu,\"enqueue\":%.3f",
+                     log.size, log.streamID.c_str(), log.opCount, (log.timestamp - origin) * 1e6);
+            if (found && end > start)
+                slice(log.ncclFunction, "nccl", r, tid, start, end, args);
+            else
+                instant(log.ncclFunction, "nccl", r, tid, log.timestamp, args);
+        }
+    }
+
+    // F/B processes nest inside the iteration slice of their rank
+    for (const auto &ppInfo : iteration.PP_info)
+    {
+        for (const auto &stage : ppInfo.nodes)
+        {
+            for (const auto &node : stage)
+            {
+                if (node.endTime <= node.startTime || node.rank.id >= numRanks)
+                    continue;
+                // Recv/Send posting times on the trace clock, -1 if none
+                snprintf(args, sizeof(args), "\"stage\":%d,\"recv\":%.3f,\"send\":%.3f", node.rank.getPp(),
+                         node.recvTime != 0 ? (node.recvTime - origin) * 1e6 : -1, node.sendTime != 0 ? (node.sendTime - origin) * 1e6 : -1);
+                slice(node.processID, "process", node.rank.id, 0, node.startTime, node.endTime, args);
+            }
+        }
+    }
+    out.flush();
+}
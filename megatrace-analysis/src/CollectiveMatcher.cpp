@@ -0,0 +1,200 @@
+#include "CollectiveMatcher.hpp"
+#include "Findings.hpp"
+#include <iostream>
+#include <algorithm>
+#include <iomanip>
+
+CollectiveArrival::CollectiveArrival()
+    : ncclFunction(""),
+      opCount(0),
+      base(0),
+      first(0),
+      last(0),
+      sum(0),
+      firstRank(-1),
+      lastRank(-1),
+      count(0) {}
+
+void CollectiveArrival::add(const NCCLLog &log)
+{
+    if (count == 0)
+    {
+        ncclFunction = log.ncclFunction;
+        opCount = log.opCount;
+        base = first = last = log.timestamp;
+        firstRank = lastRank = log.rankID;
+    }
+    if (log.timestamp < first)
+    {
+        first = log.timestamp;
+        firstRank = log.rankID;
+    }
+    if (log.timestamp > last)
+    {
+        last = log.timestamp;
+        lastRank = log.rankID;
+    }
+    // relative to the first record seen to keep the sum precise
+    sum += log.timestamp - base;
+    count++;
+}
+
+double CollectiveArrival::skew() const
+{
+    return last - first;
+}
+
+double CollectiveArrival::waitCaused() const
+{
+    return count * (last - base) - sum;
+}
+
+RankSkew::RankSkew()
+    : lateCount(0),
+      waitCaused(0),
+      maxSkew(0),
+      maxSkewFunction("") {}
+
+static bool isP2P(const std::string &ncclFunction)
+{
+    return ncclFunction == "ncclSend" || ncclFunction == "ncclRecv";
+}
+
+std::vector<std::string> collectiveKeys(const std::vector<NCCLLog> &logs, const Rank &rank)
+{
+    std::string tpStream = "-1", dpStream = "-1";
+    std::unordered_map<std::string, size_t> streamSize;
+    size_t maxSize = 0;
+    for (const auto &log : logs)
+    {
+        if (!log.commHash.empty())
+            continue;
+        size_t size = ++streamSize[log.streamID];
+        if (size > maxSize)
+        {
+            maxSize = size;
+            tpStream = log.streamID;
+        }
+        if (log.ncclFunction == "ncclReduceScatter")
+            dpStream = log.streamID;
+    }
+
+    std::vector<std::string> keys(logs.size());
+    for (size_t i = 0; i < logs.size(); i++)
+    {
+        const NCCLLog &log = logs[i];
+        if (isP2P(log.ncclFunction))
+            continue;
+        if (!log.commHash.empty())
+            keys[i] = log.commHash;
+        else if (log.streamID == tpStream)
+            keys[i] = "tp" + std::to_string(rank.getTpGroup());
+        else if (log.streamID == dpStream)
+            keys[i] = "dp" + std::to_string(rank.getDpGroup());
+    }
+    return keys;
+}
+
+std::unordered_map<std::string, std::vector<CollectiveArrival>>
+collectArrivals(const std::vector<std::vector<NCCLLog>> &historyLogs, Rank *ranks, int numRanks,
+                std::vector<std::vector<std::string>> &keys, std::vector<std::vector<size_t>> &ordinals)
+{
+    std::unordered_map<std::string, std::vector<CollectiveArrival>> arrivals;
+    keys.assign(numRanks, {});
+    ordinals.assign(numRanks, {});
+
+    for (int r = 0; r < numRanks && r < (int)historyLogs.size(); r++)
+    {
+        const std::vector<NCCLLog> &logs = historyLogs[r];
+        keys[r] = collectiveKeys(logs, ranks[r]);
+        ordinals[r].resize(logs.size());
+
+        std::unordered_map<std::string, size_t> ordinal;
+        for (size_t i = 0; i < logs.size(); i++)
+        {
+            if (keys[r][i].empty())
+                continue;
+            size_t k = ordinals[r][i] = ordinal[keys[r][i]]++;
+            std::vector<CollectiveArrival> &collectives = arrivals[keys[r][i]];
+            if (collectives.size() <= k)
+                collectives.resize(k + 1);
+            collectives[k].add(logs[i]);
+        }
+    }
+    return arrivals;
+}
+
+std::vector<RankSkew> matchCollectives(const std::vector<std::vector<NCCLLog>> &historyLogs, Rank *ranks, int numRanks)
+{
+    std::vector<std::vector<std::string>> keys;
+    std::vector<std::vector<size_t>> ordinals;
+    auto arrivals = collectArrivals(historyLogs, ranks, numRanks, keys, ordinals);
+
+    std::vector<RankSkew> skews(numRanks);
+    for (const auto &comm : arrivals)
+    {
+        for (const auto &arrival : comm.second)
+        {
+            if (arrival.count < 2 || arrival.lastRank < 0 || arrival.lastRank >= numRanks)
+                continue;
+            RankSkew &skew = skews[arrival.lastRank];
+            skew.lateCount++;
+            skew.waitCaused += arrival.waitCaused();
+            if (arrival.skew() > skew.maxSkew)
+            {
+                skew.maxSkew = arrival.skew();
+                skew.maxSkewFunction = arrival.ncclFunction;
+            }
+        }
+    }
+    return skews;
+}
+
+std::vector<std::vector<double>> lastArrivals(const std::vector<std::vector<NCCLLog>> &historyLogs, Rank *ranks, int numRanks)
+{
+    std::vector<std::vector<std::string>> keys;
+    std::vector<std::vector<size_t>> ordinals;
+    auto arrivals = collectArrivals(historyLogs, ranks, numRanks, keys, ordinals);
+
+    std::vector<std::vector<double>> last(numRanks);
+    for (int r = 0; r < numRanks && r < (int)historyLogs.size(); r++)
+    {
+        last[r].assign(historyLogs[r].size(), 0);
+        for (size_t i = 0; i < keys[r].size(); i++)
+        {
+            if (keys[r][i].empty())
+                continue;
+            const CollectiveArrival &arrival = arrivals[keys[r][i]][ordinals[r][i]];
+            if (arrival.count >= 2)
+                last[r][i] = arrival.last;
+        }
+    }
+    return last;
+}
+
+void writeSkewHeader(std::ofstream &outFile)
+{
+    outFile << "Iteration,Rank,LateCount,WaitCaused,MaxSkew,MaxSkewFunction" << std::endl;
+}
+
+// Writes every rank's row and prints the rank others waited for the most.
+void reportSkew(std::ofstream &outFile, const std::vector<RankSkew> &skews, int iteration)
+{
+    int straggler = -1;
+    outFile << std::fixed << std::setprecision(6);
+    for (size_t i = 0; i < skews.size(); i++)
+    {
+        const RankSkew &skew = skews[i];
+        if (skew.lateCount == 0)
+            continue;
+        outFile << iteration << "," << i << "," << skew.lateCount << "," << skew.waitCaused << ","
+                << skew.maxSkew << "," << skew.maxSkewFunction << std::endl;
+        if (straggler < 0 || skew.waitCaused > skews[straggler].waitCaused)
+            straggler = i;
+    }
+    if (straggler >= 0)
+    {
+        Finding("straggler").rank(straggler).add("ITERATION", iteration).add("FUNCTION", skews[straggler].maxSkewFunction)
+            .add("WAITED", skews[straggler].waitCaused).add("MAXSKEW", skews[straggler].maxSkew).emit();
+    }
+}
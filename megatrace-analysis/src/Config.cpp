@@ -1,5 +1,6 @@
 #include <iostream>
 #include <vector>
+#include <algorithm>
 #include "Config.hpp"
 
 TrainingProcess::TrainingProcess(std::string name, size_t iteration, size_t startIdx, size_t endIdx)
@@ -8,6 +9,33 @@ TrainingProcess::TrainingProcess(std::string name, size_t iteration, size_t star
       startIdx(startIdx),
       endIdx(endIdx) {}
 
+std::set<int> parseIterationList(const std::string &list)
+{
+    std::set<int> iterations;
+    size_t pos = 0;
+    while (pos < list.size())
+    {
+        size_t end = list.find(',', pos);
+        if (end == std::string::npos)
+            end = list.size();
+        std::string item = list.substr(pos, end - pos);
+        pos = end + 1;
+        size_t dash = item.find('-', 1);
+        try
+        {
+            int first = std::stoi(item.substr(0, dash));
+            int last = dash == std::string::npos ? first : std::stoi(item.substr(dash + 1));
+            for (int i = first; i <= last; i++)
+                iterations.insert(i);
+        }
+        catch (...)
+        {
+            std::cerr << "Ignoring iteration \"" << item << "\"" << std::endl;
+        }
+    }
+    return iterations;
+}
+
 std::vector<std::vector<TrainingProcess>> gen_training_pattern(TrainingConfig config)
 {
     int microbsz = config.GBS / ((config.numRanks) / (config.tpSize * config.ppSize));
@@ -16,8 +44,39 @@ std::vector<std::vector<TrainingProcess>> gen_training_pattern(TrainingConfig co
 
     std::vector<std::vector<TrainingProcess>> trainingPatterns(config.ppSize);
 
+    int vpSize = config.vpSize;
+    for (int ppIdx = 0; ppIdx < config.ppSize && vpSize > 1; ppIdx++)
+    {
+        // Megatron's interleaved schedule: virtual microbatch k runs chunk
+        // (k % (pp * vp)) / pp, forwards in chunk order and backwards in
+        // reverse, on microbatch (k / (pp * vp)) * pp + k % pp
+        int virtualNum = microbsz * vpSize;
+        int group = config.ppSize * vpSize;
+        int warmUpSize = microbsz == config.ppSize ? virtualNum : std::min(virtualNum, (config.ppSize - ppIdx - 1) * 2 + (vpSize - 1) * config.ppSize);
+        auto name = [&](int k, bool isForward)
+        {
+            int chunk = k % group / config.ppSize;
+            if (!isForward)
+                chunk = vpSize - 1 - chunk;
+            int virtualIdx = chunk * config.ppSize + ppIdx;
+            int microbatch = k / group * config.ppSize + k % config.ppSize + 1;
+            return std::to_string(microbatch) + (isForward ? "F" + std::to_string(virtualIdx) : "B" + std::to_string(group - 1 - virtualIdx));
+        };
+        for (size_t iterCnt = 1; iterCnt <= config.iterations; iterCnt++)
+        {
+            for (int k = 0; k < warmUpSize; k++)
+                trainingPatterns[ppIdx].emplace_back(name(k, true), iterCnt, -1, -1);
+            for (int k = 0; k < virtualNum - warmUpSize; k++)
+            {
+                trainingPatterns[ppIdx].emplace_back(name(k + warmUpSize, true), iterCnt, -1, -1);
+                trainingPatterns[ppIdx].emplace_back(name(k, false), iterCnt, -1, -1);
+            }
+            for (int k = virtualNum - warmUpSize; k < virtualNum; k++)
+                trainingPatterns[ppIdx].emplace_back(name(k, false), iterCnt, -1, -1);
+        }
+    }
 
-    for (int ppIdx = 0; ppIdx < config.ppSize; ppIdx++)
+    for (int ppIdx = 0; ppIdx < config.ppSize && vpSize == 1; ppIdx++)
     {
         int warmUpSize = config.ppSize - ppIdx;
 
@@ -52,139 +111,124 @@ std::vector<std::vector<TrainingProcess>> gen_training_pattern(TrainingConfig co
     }
 
     if (config.isSP)
-        _gen_training_pattern_withSP(layerNumPerRank, trainingPatterns);
+        _gen_training_pattern_withSP(layerNumPerRank, vpSize, trainingPatterns);
     else
-        _gen_training_pattern_withoutSP(layerNumPerRank, trainingPatterns);
+        _gen_training_pattern_withoutSP(layerNumPerRank, vpSize, trainingPatterns);
 
     return trainingPatterns;
 }
 
-void _gen_training_pattern_withSP(int layerNumPerRank, std::vector<std::vector<TrainingProcess>> &trainingPatterns)
+int virtualStage(const std::string &name, int ppSize, int vpSize)
 {
-    int uselessLogEndIdx = 16;  // hard code
-    int batchFinishLogSize = 8; // hard code 
-
-    int first_pp_forward_log_size = 5 + layerNumPerRank * 4; // 3 broadcast + 1 allreduce + layerNum*2 allgather&reducescatter + send
-    int normal_pp_forward_log_size = 2 + layerNumPerRank * 4;
-    int last_pp_forward_log_size = 8 + layerNumPerRank * 4; //  recv + 3 broadcast + layerNum*2 allgather&reducescatter + 1 allgather + 3 allreduce
+    size_t pos = name.find_first_not_of("0123456789");
+    if (pos == 0 || pos == std::string::npos || pos + 1 >= name.size() || (name[pos] != 'F' && name[pos] != 'B'))
+        return -1;
+    int idx = std::stoi(name.substr(pos + 1));
+    return name[pos] == 'F' ? idx : ppSize * vpSize - 1 - idx;
+}
 
-    int first_pp_backward_log_size = 2 + layerNumPerRank * 6; //  recv + layerNum*2 allgather&allgather&reducescatter  + 1 allgather
-    int normal_pp_backward_log_size = 2 + layerNumPerRank * 6;
-    int last_pp_backward_log_size = 3 + layerNumPerRank * 6; //  1 allgather + 1 reducescatter + layerNum*2 allgather&allgather&reducescatter + send
+bool parseProcessName(const std::string &name, int &batch, char &direction)
+{
+    size_t pos = name.find_first_not_of("0123456789");
+    if (pos == 0 || pos == std::string::npos || (name[pos] != 'F' && name[pos] != 'B'))
+        return false;
+    batch = std::stoi(name.substr(0, pos));
+    direction = name[pos];
+    return true;
+}
 
-    for (size_t ppIdx = 0; ppIdx < trainingPatterns.size(); ppIdx++)
+StageLayout handLayout(int layerNumPerRank, size_t ppIdx, size_t ppSize, bool isSP)
+{
+    bool isFirst = ppIdx == 0, isLast = ppIdx == ppSize - 1;
+    if (isSP)
     {
-        int startIdx = uselessLogEndIdx + 1;
-        int iterCnt = 1;
-        for (size_t i = 0; i < trainingPatterns[ppIdx].size(); i++)
-        {
-            int forward_log_size = normal_pp_forward_log_size;
-            int backward_log_size = normal_pp_backward_log_size;
-
-            if (ppIdx == 0)
-            {
-                forward_log_size = first_pp_forward_log_size;
-                backward_log_size = first_pp_backward_log_size;
-            }
-            else if (ppIdx == trainingPatterns.size() - 1)
-            {
-                forward_log_size = last_pp_forward_log_size;
-                backward_log_size = last_pp_backward_log_size;
-            }
-
-            if (iterCnt != trainingPatterns[ppIdx][i].iteration)
-            {
-                startIdx += batchFinishLogSize;
-                iterCnt++;
-            }
-            trainingPatterns[ppIdx][i].startIdx = startIdx;
-
-            if (trainingPatterns[ppIdx][i].name.find("F") != std::string::npos)
-            {
-                trainingPatterns[ppIdx][i].endIdx = startIdx + forward_log_size - 1;
-            }
-            else if (trainingPatterns[ppIdx][i].name.find("B") != std::string::npos)
-            {
-                trainingPatterns[ppIdx][i].endIdx = startIdx + backward_log_size - 1;
-            }
-            else
-            {
-                std::cout << "error in gen_training_pattern_withSP" << std::endl;
-            }
-
-            startIdx = trainingPatterns[ppIdx][i].endIdx + 1;
-        }
+        StageLayout layout;
+        layout.preamble = 16; // hard code
+        layout.tail = 8;      // hard code
+        // first:  3 broadcast + 1 allreduce + layerNum*2 allgather&reducescatter + send
+        // last:   recv + 3 broadcast + layerNum*2 allgather&reducescatter + 1 allgather + 3 allreduce
+        layout.forward = (isFirst ? 5 : isLast ? 8 : 2) + layerNumPerRank * 4;
+        // first:  recv + layerNum*2 allgather&allgather&reducescatter + 1 allgather
+        // last:   1 allgather + 1 reducescatter + layerNum*2 allgather&allgather&reducescatter + send
+        layout.backward = (isLast && !isFirst ? 3 : 2) + layerNumPerRank * 6;
+        return layout;
     }
+    StageLayout layout;
+    layout.preamble = 16; //  hard code
+    layout.tail = 7;      //  hard code
+    // first:  3 broadcast + 1 allreduce + layerNum*2 allreduce + 1 send
+    // last:   1 recv + 3 broadcast + layerNum*2 allreduce + 4 allreduce
+    layout.forward = (isFirst ? 5 : isLast ? 8 : 2) + layerNumPerRank * 2;
+    // first:  1 recv + layerNum*2 allreduce
+    // last:   1 allreduce + layerNum*2 allreduce +  1 send
+    layout.backward = (isFirst ? 1 : 2) + layerNumPerRank * 2;
+    return layout;
 }
 
-void _gen_training_pattern_withoutSP(int layerNumPerRank, std::vector<std::vector<TrainingProcess>> &trainingPatterns)
+void layoutStage(std::vector<TrainingProcess> &processes, size_t ppSize, size_t vpSize,
+                 const std::vector<StageLayout> &chunks, bool isSP)
 {
-    int uselessLogEndIdx = 16; //  hard code
-    int batchFinishLogSize = 7; //  hard code
-
-    int first_pp_forward_log_size = 5 + layerNumPerRank * 2; // 3 broadcast + 1 allreduce + layerNum*2 allreduce + 1 send
-    int normal_pp_forward_log_size = 2 + layerNumPerRank * 2;
-    int last_pp_forward_log_size = 8 + layerNumPerRank * 2; //  1 recv + 3 broadcast + layerNum*2 allreduce + 4 allreduce
-
-    int first_pp_backward_log_size = 1 + layerNumPerRank * 2; //  1 recv + layerNum*2 allreduce
-    int normal_pp_backward_log_size = 2 + layerNumPerRank * 2;
-    int last_pp_backward_log_size = 2 + layerNumPerRank * 2; //  1 allreduce + layerNum*2 allreduce +  1 send
-
-    for (size_t ppIdx = 0; ppIdx < trainingPatterns.size(); ppIdx++)
+    int lastVirtual = ppSize * vpSize - 1;
+    int startIdx = chunks[0].preamble + 1;
+    size_t iterCnt = 1;
+    for (size_t i = 0; i < processes.size(); i++)
     {
-        int startIdx = uselessLogEndIdx + 1;
-        int iterCnt = 1;
-        for (size_t i = 0; i < trainingPatterns[ppIdx].size(); i++)
+        if (iterCnt != processes[i].iteration)
         {
-            int forward_log_size = normal_pp_forward_log_size;
-            int backward_log_size = normal_pp_backward_log_size;
-
-            if (ppIdx == 0)
-            {
-                forward_log_size = first_pp_forward_log_size;
-                backward_log_size = first_pp_backward_log_size;
-            }
-            else if (ppIdx == trainingPatterns.size() - 1)
-            {
-                forward_log_size = last_pp_forward_log_size;
-                backward_log_size = last_pp_backward_log_size;
-            }
-
-            if (iterCnt != trainingPatterns[ppIdx][i].iteration)
-            {
-                startIdx += batchFinishLogSize;
-                iterCnt++;
-            }
-            trainingPatterns[ppIdx][i].startIdx = startIdx;
-
-            if (trainingPatterns[ppIdx][i].name.find("F") != std::string::npos)
-            {
-                if (ppIdx != 0) //  skip the send recv
-                    trainingPatterns[ppIdx][i].startIdx++;
-
-                trainingPatterns[ppIdx][i].endIdx = startIdx + forward_log_size - 1;
-                // if(ppIdx != trainingPatterns.size() - 1)
-                trainingPatterns[ppIdx][i].endIdx--; //  skip the send recv
+            startIdx += chunks[0].tail;
+            iterCnt++;
+        }
+        processes[i].startIdx = startIdx;
+        bool isForward = processes[i].name.find("F") != std::string::npos;
+        int virtualIdx = virtualStage(processes[i].name, ppSize, vpSize);
+        if (virtualIdx < 0 || virtualIdx > lastVirtual)
+        {
+            std::cout << "error in gen_training_pattern" << std::endl;
+            virtualIdx = 0;
+        }
+        const StageLayout &layout = chunks[virtualIdx / ppSize];
+        int size = isForward ? layout.forward : layout.backward;
+        processes[i].endIdx = startIdx + size - 1;
+        startIdx += size;
+        if (isSP) // SP 模式下 PP 的 send/recv 在 process 内部
+            continue;
+
+        //  skip the send recv
+        if (isForward)
+        {
+            if (virtualIdx != 0)
+                processes[i].startIdx++;
+            processes[i].endIdx--;
+        }
+        else
+        {
+            if (virtualIdx != lastVirtual)
+                processes[i].startIdx++;
+            if (virtualIdx != 0)
+                processes[i].endIdx--;
+        }
+    }
+}
 
-                startIdx += forward_log_size;
-                continue;
-            }
-            else if (trainingPatterns[ppIdx][i].name.find("B") != std::string::npos)
-            {
-                if (ppIdx != trainingPatterns.size() - 1)
-                    trainingPatterns[ppIdx][i].startIdx++; //   
+// chunk c of stage ppIdx laid out as virtual stage c * ppSize + ppIdx
+static std::vector<StageLayout> handChunks(int layerNumPerRank, int vpSize, size_t ppIdx, size_t ppSize, bool isSP)
+{
+    std::vector<StageLayout> chunks;
+    for (int chunk = 0; chunk < vpSize; chunk++)
+        chunks.push_back(handLayout(layerNumPerRank / vpSize, chunk * ppSize + ppIdx, ppSize * vpSize, isSP));
+    return chunks;
+}
 
-                trainingPatterns[ppIdx][i].endIdx = startIdx + backward_log_size - 1;
-                if (ppIdx != 0)
-                    trainingPatterns[ppIdx][i].endIdx--; //  
+void _gen_training_pattern_withSP(int layerNumPerRank, int vpSize, std::vector<std::vector<TrainingProcess>> &trainingPatterns)
+{
+    size_t ppSize = trainingPatterns.size();
+    for (size_t ppIdx = 0; ppIdx < ppSize; ppIdx++)
+        layoutStage(trainingPatterns[ppIdx], ppSize, vpSize, handChunks(layerNumPerRank, vpSize, ppIdx, ppSize, true), true);
+}
 
-                startIdx += backward_log_size;
-                continue;
-            }
-            else
-            {
-                std::cout << "error in gen_training_pattern_withSP" << std::endl;
-            }
-        }
-    }
-}
\ No newline at end of file
+void _gen_training_pattern_withoutSP(int layerNumPerRank, int vpSize, std::vector<std::vector<TrainingProcess>> &trainingPatterns)
+{
+    size_t ppSize = trainingPatterns.size();
+    for (size_t ppIdx = 0; ppIdx < ppSize; ppIdx++)
+        layoutStage(trainingPatterns[ppIdx], ppSize, vpSize, handChunks(layerNumPerRank, vpSize, ppIdx, ppSize, false), false);
+}
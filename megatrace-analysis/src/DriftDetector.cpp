@@ -0,0 +1,168 @@
+#include "DriftDetector.hpp"
+#include "Findings.hpp"
+#include "CollectiveMatcher.hpp"
+#include <iostream>
+#include <algorithm>
+#include <iomanip>
+#include <map>
+#include <sstream>
+
+DriftDetector::DriftDetector()
+    : reference(0),
+      sum(0),
+      count(0),
+      since(0) {}
+
+bool DriftDetector::add(double x, int iteration, int warmup, double delta, double threshold)
+{
+    if (x <= 0)
+        return false;
+    if (count < warmup)
+    {
+        reference += (x - reference) / ++count;
+        since = iteration;
+        return false;
+    }
+    sum = std::max(0.0, sum + x / reference - 1 - delta);
+    if (sum == 0)
+        since = iteration;
+    if (sum <= threshold)
+        return false;
+    sum = 0;
+    count = 0;
+    reference = 0;
+    return true;
+}
+
+DriftMonitor::DriftMonitor(const TrainingConfig &config)
+    : warmup(config.driftWarmup),
+      delta(config.driftDelta),
+      threshold(config.driftThreshold) {}
+
+void writeDriftHeader(std::ofstream &outFile)
+{
+    outFile << "Iteration,Series,Key,Since,Reference,Current,Ranks" << std::endl;
+}
+
+void DriftMonitor::addIteration(std::ofstream &outFile, const Iteration &iteration, Rank *rankInfo, int numRanks,
+                                const TelemetryIndex &telemetry)
+{
+    outFile << std::fixed << std::setprecision(6);
+    auto report = [&](const char *series, const std::string &key, const DriftDetector &detector,
+                      double reference, double current, const std::vector<int> &members)
+    {
+        std::string rankList;
+        for (int r : members)
+            rankList += (rankList.empty() ? "" : "/") + std::to_string(r);
+        outFile << iteration.iter << "," << series << "," << key << "," << detector.since + 1 << ","
+                << reference << "," << current << "," << rankList << std::endl;
+        Finding("drift").add("RANK", members).add("ITERATION", iteration.iter).add("SINCE", detector.since + 1)
+            .add("SERIES", series).add("KEY", key).add("INCREASE", current / reference - 1).emit();
+    };
+
+    // per rank: total F/B process time of the iteration
+    std::map<int, double> rankTime;
+    for (const auto &ppInfo : iteration.PP_info)
+        for (const auto &stage : ppInfo.nodes)
+            for (const auto &node : stage)
+                if (node.duration > 0 && node.processID.find_first_of("FB") != std::string::npos)
+                    rankTime[node.rank.id] += node.duration;
+    for (const auto &it : rankTime)
+    {
+        DriftDetector &detector = ranks[it.first];
+        DriftDetector before = detector;
+        if (detector.add(it.second, iteration.iter, warmup, delta, threshold))
+            report("stage", std::to_string(it.first), before, before.reference, it.second, {it.first});
+    }
+
+    // per communicator: mean collective latency of the iteration; a slow GPU
+    // would otherwise read as drift on every comm it takes part in
+    if (telemetry.records.empty())
+        return;
+    std::vector<std::vector<std::string>> keys;
+    std::vector<std::vector<size_t>> ordinals;
+    auto arrivals = collectArrivals(iteration.historyLogs, rankInfo, numRanks, keys, ordinals);
+    std::unordered_map<std::string, std::vector<int>> members;
+    for (int r = 0; r < (int)keys.size(); r++)
+    {
+        std::unordered_map<std::string, bool> seen;
+        for (const auto &key : keys[r])
+            if (!key.empty() && !seen[key])
+            {
+                seen[key] = true;
+                members[key].push_back(r);
+            }
+    }
+    for (const auto &comm : arrivals)
+    {
+        const std::vector<CollectiveArrival> &collectives = comm.second;
+        double total = 0;
+        int samples = 0;
+        for (size_t k = 0; k < collectives.size(); k++)
+        {
+            const std::vector<size_t> *rows = telemetry.find(comm.first, collectives[k].opCount);
+            if (rows != nullptr)
+            {
+                double start = telemetry.records[rows->front()].startTime, end = 0;
+                for (size_t row : *rows)
+                {
+                    start = std::min(start, telemetry.records[row].startTime);
+                    end = std::max(end, telemetry.records[row].endTime);
+                }
+                total += end - start;
+                samples++;
+            }
+        }
+        if (samples == 0)
+            continue;
+        double latency = total / samples;
+        DriftDetector &detector = comms[comm.first];
+        DriftDetector before = detector;
+        if (detector.add(latency, iteration.iter, warmup, delta, threshold))
+            report("comm", comm.first, before, before.reference, latency, members[comm.first]);
+    }
+}
+
+bool DriftMonitor::save(const std::string &path, const std::string &model) const
+{
+    std::ofstream file(path, std::ios::out);
+    if (!file.is_open())
+        return false;
+    file << "model " << model << std::endl;
+    file << std::setprecision(17);
+    auto write = [&](const char *series, const std::string &key, const DriftDetector &detector)
+    {
+        file << series << " " << key << " " << detector.reference << " " << detector.sum << " "
+             << detector.count << " " << detector.since << std::endl;
+    };
+    for (const auto &it : ranks)
+        write("rank", std::to_string(it.first), it.second);
+    for (const auto &it : comms)
+        write("comm", it.first, it.second);
+    return file.good();
+}
+
+bool DriftMonitor::load(const std::string &path, const std::string &model)
+{
+    std::ifstream file(path);
+    if (!file.is_open())
+        return false;
+    std::string line, tag, key;
+    if (!std::getline(file, line) || line != "model " + model)
+    {
+        std::cerr << "Drift state " << path << " was written for another model, starting cold" << std::endl;
+        return false;
+    }
+    while (std::getline(file, line))
+    {
+        std::istringstream in(line);
+        DriftDetector detector;
+        if (!(in >> tag >> key >> detector.reference >> detector.sum >> detector.count >> detector.since))
+            continue;
+        if (tag == "rank")
+            ranks[std::stoi(key)] = detector;
+        else if (tag == "comm")
+            comms[key] = detector;
+    }
+    return true;
+}
@@ -0,0 +1,167 @@
+#include "Findings.hpp"
+#include <iostream>
+#include <fstream>
+#include <mutex>
+#include <map>
+#include <cctype>
+
+static std::mutex reportMutex;
+static std::ofstream reportFile;
+static const Rank *reportRanks = nullptr;
+static int reportNumRanks = 0;
+static std::map<std::string, int> pendingCounts;
+
+static std::string jsonNumber(const std::string &text)
+{
+    if (text.find("nan") != std::string::npos || text.find("inf") != std::string::npos)
+        return "null";
+    return text;
+}
+
+static std::string jsonString(const std::string &value)
+{
+    std::string out = "\"";
+    for (char c : value)
+    {
+        if (c == '"' || c == '\\')
+            out += '\\';
+        if (c == '\n')
+        {
+            out += "\\n";
+            continue;
+        }
+        out += c;
+    }
+    return out + "\"";
+}
+
+// "ISCRITICAL" -> "critical", other keys lowercased
+static std::string jsonKey(const std::string &key)
+{
+    if (key == "ISCRITICAL")
+        return "critical";
+    if (key == "PPGROUP")
+        return "ppGroup";
+    std::string out;
+    for (char c : key)
+        out += std::tolower((unsigned char)c);
+    return out;
+}
+
+Finding::Finding(const std::string &type)
+    : type(type),
+      rankID(-1) {}
+
+Finding &Finding::field(const std::string &key, const std::string &text, bool isNumber, bool isPrinted,
+                        bool isList, bool isBool)
+{
+    fields.push_back({key, text, isNumber, isPrinted, isList, isBool});
+    return *this;
+}
+
+Finding &Finding::rank(int id)
+{
+    rankID = id;
+    return add("RANK", id);
+}
+
+Finding &Finding::add(const std::string &key, const std::string &value)
+{
+    return field(key, value, false, true);
+}
+
+Finding &Finding::add(const std::string &key, const char *value)
+{
+    return field(key, value, false, true);
+}
+
+// printed as 0/1 like the stream would, reported as a JSON boolean
+Finding &Finding::add(const std::string &key, bool value)
+{
+    return field(key, value ? "1" : "0", true, true, false, true);
+}
+
+void Finding::emit() const
+{
+    std::lock_guard<std::mutex> lock(reportMutex);
+    std::cout << "TYPE: " << type;
+    for (const auto &f : fields)
+        if (f.isPrinted)
+            std::cout << ", " << f.key << ": " << f.text;
+    std::cout << std::endl;
+
+    if (!reportFile.is_open())
+        return;
+    pendingCounts[type]++;
+    reportFile << "{\"type\":" << jsonString(type);
+    if (rankID >= 0 && rankID < reportNumRanks)
+    {
+        const Rank &r = reportRanks[rankID];
+        reportFile << ",\"tpGroup\":" << r.getTpGroup() << ",\"ppGroup\":" << r.getPpGroup()
+                   << ",\"dpGroup\":" << r.getDpGroup() << ",\"stage\":" << r.getPp();
+    }
+    for (const auto &f : fields)
+    {
+        std::string key = jsonKey(f.key);
+        if (rankID >= 0 && key == "ppGroup")
+            continue;
+        reportFile << "," << jsonString(key) << ":";
+        if (f.isList)
+        {
+            // "a/b/c" -> [a,b,c]
+            std::istringstream items(f.text);
+            std::string item;
+            reportFile << "[";
+            for (bool first = true; std::getline(items, item, '/'); first = false)
+                reportFile << (first ? "" : ",") << jsonNumber(item);
+            reportFile << "]";
+        }
+        else if (!f.isNumber)
+            reportFile << jsonString(f.text);
+        else if (f.isBool)
+            reportFile << (f.text == "1" ? "true" : "false");
+        else
+            reportFile << jsonNumber(f.text);
+    }
+    reportFile << "}\n";
+    reportFile.flush();
+}
+
+bool openFindingReport(const std::string &path, const Rank *ranks, int numRanks, bool append)
+{
+    std::lock_guard<std::mutex> lock(reportMutex);
+    if (reportFile.is_open())
+        return false;
+    reportFile.open(path, append ? std::ios::app : std::ios::out);
+    reportRanks = ranks;
+    reportNumRanks = ranks == nullptr ? 0 : numRanks;
+    pendingCounts.clear();
+    return reportFile.is_open();
+}
+
+void reportIterationSummary(int iteration, bool isHang, double analysisSeconds)
+{
+    std::lock_guard<std::mutex> lock(reportMutex);
+    if (!reportFile.is_open())
+        return;
+    reportFile << "{\"type\":\"summary\",\"iteration\":" << iteration << ",\"hang\":" << (isHang ? "true" : "false")
+               << ",\"analysisSeconds\":" << analysisSeconds << ",\"findings\":{";
+    bool first = true;
+    for (const auto &count : pendingCounts)
+    {
+        reportFile << (first ? "" : ",") << jsonString(count.first) << ":" << count.second;
+        first = false;
+    }
+    reportFile << "}}\n";
+    reportFile.flush();
+    pendingCounts.clear();
+}
+
+void closeFindingReport()
+{
+    std::lock_guard<std::mutex> lock(reportMutex);
+    if (reportFile.is_open())
+        reportFile.close();
+    reportRanks = nullptr;
+    reportNumRanks = 0;
+}
@@ -0,0 +1,111 @@
+#include "GanttChart.hpp"
+#include "OutputSink.hpp"
+#include <iostream>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+#include <limits>
+#include <atomic>
+#include <thread>
+
+static const double CHART_WIDTH = 1200;
+static const double LABEL_WIDTH = 90;
+static const double ROW_HEIGHT = 28;
+static const double HEADER_HEIGHT = 30;
+static const double AXIS_HEIGHT = 30;
+
+void writeGantt(const Graph &graph, const std::string &outputFileName, int ppSize)
+{
+    std::vector<const Node *> bars;
+    double start = std::numeric_limits<double>::max();
+    double end = 0;
+    for (const auto &it : graph.nodes)
+    {
+        const Node &node = it.second;
+        if (node.processID == "endNode" || node.startTime <= 0)
+            continue;
+        bars.push_back(&node);
+        start = std::min(start, node.startTime);
+        end = std::max(end, std::max(node.startTime, node.endTime));
+    }
+    if (bars.empty())
+        return;
+    std::ostringstream svg;
+
+    double span = std::max(end - start, 1e-6);
+    double plotWidth = CHART_WIDTH - LABEL_WIDTH - 10;
+    auto x = [&](double t)
+    { return LABEL_WIDTH + (t - start) / span * plotWidth; };
+    double height = HEADER_HEIGHT + ppSize * ROW_HEIGHT + AXIS_HEIGHT;
+
+    svg << std::fixed << std::setprecision(2);
+    svg << "<svg xmlns=\"http://www.w3.org/2000/svg\" width=\"" << CHART_WIDTH << "\" height=\"" << height
+        << "\" font-family=\"sans-serif\" font-size=\"11\">" << std::endl;
+    svg << "<rect width=\"100%\" height=\"100%\" fill=\"white\"/>" << std::endl;
+    svg << "<text x=\"" << LABEL_WIDTH << "\" y=\"20\" font-size=\"14\">iteration " << graph.iteration << ", ppGroup "
+        << graph.groupID << ", " << std::setprecision(3) << span << " s</text>" << std::setprecision(2) << std::endl;
+
+    for (int s = 0; s < ppSize; s++)
+    {
+        double y = HEADER_HEIGHT + s * ROW_HEIGHT;
+        svg << "<text x=\"5\" y=\"" << y + ROW_HEIGHT * 0.65 << "\">stage " << s << "</text>" << std::endl;
+        svg << "<line x1=\"" << LABEL_WIDTH << "\" y1=\"" << y + ROW_HEIGHT << "\" x2=\"" << CHART_WIDTH - 10
+            << "\" y2=\"" << y + ROW_HEIGHT << "\" stroke=\"#e0e0e0\"/>" << std::endl;
+    }
+    double axisY = HEADER_HEIGHT + ppSize * ROW_HEIGHT;
+    for (int tick = 0; tick <= 5; tick++)
+    {
+        double t = start + span * tick / 5;
+        svg << "<line x1=\"" << x(t) << "\" y1=\"" << HEADER_HEIGHT << "\" x2=\"" << x(t) << "\" y2=\"" << axisY + 4
+            << "\" stroke=\"#c0c0c0\"/>" << std::endl;
+        svg << "<text x=\"" << x(t) << "\" y=\"" << axisY + 18 << "\" text-anchor=\"middle\">" << std::setprecision(3)
+            << t - start << " s</text>" << std::setprecision(2) << std::endl;
+    }
+
+    for (const Node *node : bars)
+    {
+        if (node->ppIndex < 0 || node->ppIndex >= ppSize)
+            continue;
+        // a hang node never ended: it runs to the end of the chart
+        double barEnd = node->isHangNode || node->endTime <= node->startTime ? end : node->endTime;
+        double left = x(node->startTime), width = std::max(1.0, x(barEnd) - left);
+        double y = HEADER_HEIGHT + node->ppIndex * ROW_HEIGHT + 3;
+        bool isDP = node->processID.rfind("DP", 0) == 0;
+        std::string fill = node->isHangNode                              ? "#de2d26"
+                           : node->isSlowNode                            ? "#fd8d3c"
+                           : isDP                                        ? "#d9d9d9"
+                           : node->processID.find('F') != std::string::npos ? "#9ecae1"
+                                                                         : "#a1d99b";
+        svg << "<g><title>" << node->processID << " rank " << node->rank.id << std::setprecision(6)
+            << "\nstart " << node->startTime - start << " s\nduration " << barEnd - node->startTime << " s"
+            << (node->isSlowNode ? "\nslow" : "") << (node->isHangNode ? "\nhang" : "")
+            << (node->isCriticalNode ? "\ncritical" : "") << std::setprecision(2) << "</title>";
+        svg << "<rect x=\"" << left << "\" y=\"" << y << "\" width=\"" << width << "\" height=\"" << ROW_HEIGHT - 6
+            << "\" fill=\"" << fill << "\" stroke=\"" << (node->isCriticalNode ? "#08306b" : "#737373")
+            << "\" stroke-width=\"" << (node->isCriticalNode ? 2 : 0.5) << "\"/>";
+        if (width > 7 * node->processID.size())
+            svg << "<text x=\"" << left + width / 2 << "\" y=\"" << y + ROW_HEIGHT * 0.55 << "\" text-anchor=\"middle\">"
+                << node->processID << "</text>";
+        svg << "</g>" << std::endl;
+    }
+    svg << "</svg>" << std::endl;
+    if (!getOutputSink().write(outputFileName + ".svg", svg.str()))
+        std::cerr << "Error: Could not open file for writing: " << outputFileName << ".svg" << std::endl;
+}
+
+void writeGantts(const std::vector<Graph> &graphs, const std::vector<std::string> &paths, int ppSize)
+{
+    std::atomic<size_t> next(0);
+    auto render = [&]
+    {
+        for (size_t i = next++; i < graphs.size(); i = next++)
+            writeGantt(graphs[i], paths[i], ppSize);
+    };
+    size_t workers = std::min<size_t>(graphs.size(), std::max(1u, std::thread::hardware_concurrency()));
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < workers; i++)
+        threads.emplace_back(render);
+    render();
+    for (auto &t : threads)
+        t.join();
+}
@@ -11,9 +11,12 @@
 #include <iomanip>
 #include <algorithm>
 #include <climits>
+#include <sstream>
 #include "Rank.hpp"
 #include "LogParser.hpp"
 #include "GraphNode.hpp"
+#include "OutputSink.hpp"
+#include "Findings.hpp"
 
 Node::Node()
     : rank(),
@@ -25,8 +28,14 @@ Node::Node()
       duration(0),
       startTime(0),
       endTime(0),
+      recvTime(0),
+      sendTime(0),
+      expected(0),
+      slack(0),
+      confidence(0),
       isCriticalNode(false),
-      isSlowNode(false) {}
+      isSlowNode(false),
+      isHangNode(false) {}
 
 Node::Node(Rank r, const std::string &id, int iter, double start, double end)
     : rank(r),
@@ -38,6 +47,11 @@ Node::Node(Rank r, const std::string &id, int iter, double start, double end)
       duration(0),
       startTime(start),
       endTime(end),
+      recvTime(0),
+      sendTime(0),
+      expected(0),
+      slack(0),
+      confidence(0),
       isCriticalNode(false),
       isSlowNode(false),
       isHangNode(false) {};
@@ -53,12 +67,12 @@ void Node::addCausalDependency(std::string id)
     causalDependencies.push_back(id);
 }
 
-TP_Rank_SP_info::TP_Rank_SP_info(int batch_size, int tp_index)
-    : Rank_FW_ag_time(batch_size + 1, std::vector<double>(tp_index, 0)),
-      Rank_FW_rs_time(batch_size + 1, std::vector<double>(tp_index, 0)),
-      Rank_BW_ag1_time(batch_size + 1, std::vector<double>(tp_index, 0)),
-      Rank_BW_ag2_time(batch_size + 1, std::vector<double>(tp_index, 0)),
-      Rank_BW_rs_time(batch_size + 1, std::vector<double>(tp_index, 0)) {}
+TP_Rank_SP_info::TP_Rank_SP_info(int batch_size, int layer, int tp_index)
+    : Rank_FW_ag_time(batch_size + 1, std::vector<std::vector<double>>(layer * 2 + 1, std::vector<double>(tp_index, 0))),
+      Rank_FW_rs_time(batch_size + 1, std::vector<std::vector<double>>(layer * 2 + 1, std::vector<double>(tp_index, 0))),
+      Rank_BW_ag1_time(batch_size + 1, std::vector<std::vector<double>>(layer * 2 + 1, std::vector<double>(tp_index, 0))),
+      Rank_BW_ag2_time(batch_size + 1, std::vector<std::vector<double>>(layer * 2 + 1, std::vector<double>(tp_index, 0))),
+      Rank_BW_rs_time(batch_size + 1, std::vector<std::vector<double>>(layer * 2 + 1, std::vector<double>(tp_index, 0))) {}
 
 TP_Rank_info::TP_Rank_info(int batch_size, int layer, int tp_index)
     : Rank_FW_time(batch_size + 1,
@@ -72,53 +86,209 @@ DP_Rank_info::DP_Rank_info(int dp_size)
     : Rank_ag_time(dp_size, 0),
       Rank_rs_time(dp_size, 0) {}
 
+EP_Rank_info::EP_Rank_info(int ep_size)
+    : bursts(ep_size) {}
+
 PP_Rank_info::PP_Rank_info(int pp_size, int batch_size)
     : nodes(pp_size),
       timecost_sum(0) {}
 
-Iteration::Iteration(int iter_val, int TP_group_size, int PP_group_size, int DP_group_size,
-                     int batch_size, int layer, int tp_size, int pp_size, int dp_size, int numRank)
+Iteration::Iteration(int iter_val, int TP_group_size, int PP_group_size, int DP_group_size, int EP_group_size,
+                     int batch_size, int layer, int tp_size, int pp_size, int dp_size, int ep_size, int numRank, bool isSP)
     : iter(iter_val),
       TP_info(TP_group_size, TP_Rank_info(batch_size, layer, tp_size)),
+      TP_SP_info(isSP ? TP_group_size : 0, TP_Rank_SP_info(isSP ? batch_size : 0, isSP ? layer : 0, tp_size)),
       PP_info(PP_group_size, PP_Rank_info(pp_size, batch_size)),
       DP_info(DP_group_size, DP_Rank_info(dp_size)),
-      historyLogs(numRank) {}
+      EP_info(ep_size > 1 ? EP_group_size : 0, EP_Rank_info(ep_size)),
+      historyLogs(numRank),
+      opSequences(numRank) {}
+
+// samples a median cell keeps
+static const size_t BASELINE_WINDOW = 64;
 
 PPTimeTable::PPTimeTable(int pp_size, int batch_num)
     : ppGroup(pp_size),
+      estimator("mean"),
+      alpha(0.1),
+      warmup(2),
+      madThreshold(0),
+      excluded({1}),
       expectation(pp_size, std::vector<double>(batch_num * 2, 0)),
-      data_num(pp_size, std::vector<int>(batch_num * 2, 0)) {}
+      data_num(pp_size, std::vector<int>(batch_num * 2, 0)),
+      iteration_num(pp_size, std::vector<int>(batch_num * 2, 0)),
+      last_iteration(pp_size, std::vector<int>(batch_num * 2, 0)),
+      samples(pp_size, std::vector<std::vector<double>>(batch_num * 2)) {}
+
+PPTimeTable::PPTimeTable(int pp_size, int batch_num, const TrainingConfig &config)
+    : PPTimeTable(pp_size, batch_num)
+{
+    estimator = config.baselineEstimator;
+    alpha = config.ewmaAlpha;
+    warmup = config.baselineWarmup;
+    madThreshold = config.madThreshold;
+    excluded = parseIterationList(config.excludeIterations);
+}
 
 PPTimeTable::PPTimeTable()
     : ppGroup(-1),
+      estimator("mean"),
+      alpha(0.1),
+      warmup(2),
+      madThreshold(0),
       expectation(),
-      data_num() {}
+      data_num(),
+      iteration_num(),
+      last_iteration(),
+      samples() {}
+
+bool PPTimeTable::isExcluded(int iterationNum) const
+{
+    return excluded.count(iterationNum) != 0;
+}
+
+bool PPTimeTable::isReady(int ppIndex, int batchIndex) const
+{
+    return iteration_num[ppIndex][batchIndex] >= warmup && expectation[ppIndex][batchIndex] > 0;
+}
 
 bool PPTimeTable::isSlow(int ppIndex, int batchIndex, double timeCost, double threshold)
 {
     double e = expectation[ppIndex][batchIndex];
     double val = (timeCost - e) / e;
     bool ret = val > threshold;
+    // a noisy cell also needs a robust z-score above madThreshold
+    const std::vector<double> &window = samples[ppIndex][batchIndex];
+    if (ret && estimator == "median" && madThreshold > 0 && window.size() >= 2)
+    {
+        std::vector<double> deviation;
+        for (double x : window)
+            deviation.push_back(std::fabs(x - e));
+        std::nth_element(deviation.begin(), deviation.begin() + deviation.size() / 2, deviation.end());
+        double mad = 1.4826 * deviation[deviation.size() / 2];
+        ret = mad == 0 || (timeCost - e) / mad > madThreshold;
+    }
     return ret;
 }
 
 void PPTimeTable::updateTimeTable(int ppIndex, int batchIndex, double timeCost, int iterationNum)
 {
+    if (isExcluded(iterationNum) || timeCost <= 0)
+        return;
 
     double &expectationValue = expectation[ppIndex][batchIndex];
     int &cnt = data_num[ppIndex][batchIndex];
     double X = timeCost;
-    if (iterationNum == 2)
+    cnt++;
+    if (last_iteration[ppIndex][batchIndex] != iterationNum)
     {
-        cnt++;
+        last_iteration[ppIndex][batchIndex] = iterationNum;
+        iteration_num[ppIndex][batchIndex]++;
+    }
+    if (cnt == 1)
         expectationValue = X;
+    else if (estimator == "ewma")
+        expectationValue += alpha * (X - expectationValue);
+    else if (estimator != "median")
+        expectationValue += (X - expectationValue) / cnt;
+
+    // the window doubles as the persisted state of every estimator
+    std::vector<double> &window = samples[ppIndex][batchIndex];
+    if (window.size() == BASELINE_WINDOW)
+        window.erase(window.begin());
+    window.push_back(X);
+    if (estimator == "median")
+    {
+        std::vector<double> sorted(window);
+        std::nth_element(sorted.begin(), sorted.begin() + sorted.size() / 2, sorted.end());
+        expectationValue = sorted[sorted.size() / 2];
     }
-    else if (iterationNum > 2)
+}
+
+bool PPTimeTable::save(const std::string &path, const std::string &model) const
+{
+    std::ofstream file(path, std::ios::out);
+    if (!file.is_open())
+        return false;
+    file << "model " << model << std::endl;
+    file << "estimator " << estimator << std::endl;
+    file << std::setprecision(9);
+    for (size_t i = 0; i < expectation.size(); i++)
     {
-        cnt++;
-        double oldExpectation = expectationValue;
-        expectationValue += (X - oldExpectation) / cnt;
+        for (size_t j = 0; j < expectation[i].size(); j++)
+        {
+            if (data_num[i][j] == 0)
+                continue;
+            file << "cell " << i << " " << j << " " << expectation[i][j] << " " << data_num[i][j];
+            for (double x : samples[i][j])
+                file << " " << x;
+            file << std::endl;
+        }
     }
+    return true;
+}
+
+bool PPTimeTable::load(const std::string &path, const std::string &model)
+{
+    std::ifstream file(path);
+    if (!file.is_open())
+        return false;
+    std::string line, tag, value;
+    if (!std::getline(file, line) || line != "model " + model)
+    {
+        std::cerr << "Baseline " << path << " was written for another model, starting cold" << std::endl;
+        return false;
+    }
+    std::string savedEstimator;
+    while (std::getline(file, line))
+    {
+        std::istringstream in(line);
+        in >> tag;
+        if (tag == "estimator")
+        {
+            in >> savedEstimator;
+            continue;
+        }
+        size_t i, j;
+        double e, x;
+        int cnt;
+        if (tag != "cell" || !(in >> i >> j >> e >> cnt) || i >= expectation.size() || j >= expectation[i].size())
+            continue;
+        expectation[i][j] = e;
+        data_num[i][j] = cnt;
+        // the iterations behind a saved cell are not kept, count its samples
+        iteration_num[i][j] = cnt;
+        samples[i][j].clear();
+        while (in >> x)
+            samples[i][j].push_back(x);
+        // another estimator's value is re-derived from the saved samples
+        if (savedEstimator != estimator && !samples[i][j].empty())
+        {
+            std::vector<double> window(samples[i][j]);
+            if (estimator == "median")
+            {
+                std::nth_element(window.begin(), window.begin() + window.size() / 2, window.end());
+                expectation[i][j] = window[window.size() / 2];
+            }
+            else
+            {
+                expectation[i][j] = 0;
+                for (double sample : window)
+                    expectation[i][j] += sample;
+                expectation[i][j] /= window.size();
+            }
+        }
+    }
+    return true;
+}
+
+std::string modelKey(const TrainingConfig &config)
+{
+    return "layers=" + std::to_string(config.layers) + ",pp=" + std::to_string(config.ppSize) +
+           ",tp=" + std::to_string(config.tpSize) + ",dp=" + std::to_string(config.dpSize) +
+           ",GBS=" + std::to_string(config.GBS) + ",headers=" + std::to_string(config.headers) +
+           ",sp=" + std::to_string(config.isSP) +
+           (config.vpSize > 1 ? ",vp=" + std::to_string(config.vpSize) : "");
 }
 
 Graph::Graph(int iteration, int groupID, int nodeNum, int edgeNum)
@@ -155,13 +325,7 @@ double Graph::resizeNode(double duration, double minDuration, double maxDuration
 
 void Graph::graphVisualization(std::string &outputFileName)
 {
-    std::ofstream dotFile(outputFileName + ".dot");
-
-    if (!dotFile.is_open())
-    {
-        std::cerr << "Error: Could not open file for writing: " << outputFileName << std::endl;
-        return;
-    }
+    std::ostringstream dotFile;
     double minDuration = LLONG_MAX;
     double maxDuration = LLONG_MIN;
     for (const auto &node : nodes)
@@ -236,7 +400,8 @@ void Graph::graphVisualization(std::string &outputFileName)
     }
 
     dotFile << "}" << std::endl;
-    dotFile.close();
+    if (!getOutputSink().write(outputFileName + ".dot", dotFile.str()))
+        std::cerr << "Error: Could not open file for writing: " << outputFileName << std::endl;
 
     std::string command1 = "dot -Tsvg " + outputFileName + ".dot" + " -o " + outputFileName + ".svg";
     std::string command2 = "dot -Tpng " + outputFileName + ".dot" + " -o " + outputFileName + ".png";
@@ -244,9 +409,10 @@ void Graph::graphVisualization(std::string &outputFileName)
     // system(command2.c_str());
 }
 
-bool Graph::buildComputationGraph(double threshold, PP_Rank_info pp_rank_info, std::vector<DP_Rank_info> dp_Info, std::vector<std::vector<NCCLLog>> historyLogs, PPTimeTable &timetable, int expectNodeNum)
+bool Graph::buildComputationGraph(double threshold, PP_Rank_info pp_rank_info, std::vector<DP_Rank_info> dp_Info, std::vector<std::vector<NCCLLog>> historyLogs, PPTimeTable &timetable, int expectNodeNum, int vpSize)
 {
     int m = pp_rank_info.nodes.size();
+    bool interleaved = vpSize > 1;
     timetable.ppGroup = groupID;
     std::unordered_set<std::string> st;
     bool isHang = false;
@@ -262,22 +428,26 @@ bool Graph::buildComputationGraph(double threshold, PP_Rank_info pp_rank_info, s
             node.ppIndex = i;
             node.batchIndex = j;
 
-            if (iteration > 3 && timetable.isSlow(node.ppIndex, node.batchIndex, node.duration, threshold))
+            if (timetable.isReady(node.ppIndex, node.batchIndex) && timetable.isSlow(node.ppIndex, node.batchIndex, node.duration, threshold))
             {
                 node.isSlowNode = true;
                 nodes[node.processID].isSlowNode = true;
+                // 0 right at the threshold, towards 1 the further beyond it
+                node.expected = timetable.expectation[node.ppIndex][node.batchIndex];
+                double excess = (node.duration - node.expected) / node.expected;
+                node.confidence = threshold > 0 ? std::max(0.0, 1 - threshold / excess) : 1;
             }
             if (!node.isSlowNode)
                 timetable.updateTimeTable(node.ppIndex, node.batchIndex, node.duration, iteration);
             addNode(node);
             st.insert(nodes[node.processID].processID);
-            if (i != m - 1 && nodes[node.processID].processID.find('B') == std::string::npos && pp_rank_info.nodes[i + 1].size() != 0)
+            if (!interleaved && i != m - 1 && nodes[node.processID].processID.find('B') == std::string::npos && pp_rank_info.nodes[i + 1].size() != 0)
             {
                 if (j + 1 < pp_rank_info.nodes[i + 1].size() && pp_rank_info.nodes[i + 1][j].processID.find('B') != std::string::npos)
                 {
                     nodes[node.processID].addCausalDependency(pp_rank_info.nodes[i + 1][j + 1].processID);
                 }
-                else if (pp_rank_info.nodes[i + 1][j].processID.find('B') == std::string::npos && j < pp_rank_info.nodes[i + 1].size())
+                else if (j < pp_rank_info.nodes[i + 1].size() && pp_rank_info.nodes[i + 1][j].processID.find('B') == std::string::npos)
                 {
                     nodes[node.processID].addCausalDependency(pp_rank_info.nodes[i + 1][j].processID);
                 }
@@ -286,7 +456,7 @@ bool Graph::buildComputationGraph(double threshold, PP_Rank_info pp_rank_info, s
             {
                 nodes[node.processID].addCausalDependency(pp_rank_info.nodes[i][j + 1].processID);
             }
-            if (i != 0 && nodes[node.processID].processID.find('B') != std::string::npos)
+            if (!interleaved && i != 0 && nodes[node.processID].processID.find('B') != std::string::npos)
             {
                 auto &&nextBackwardID = incrementNodeID(nodes[node.processID].processID);
                 if (st.find(nextBackwardID) != st.end())
@@ -297,6 +467,28 @@ bool Graph::buildComputationGraph(double threshold, PP_Rank_info pp_rank_info, s
         }
     }
 
+    // interleaved: stage order no longer lines microbatches up, so follow the
+    // (virtual stage, microbatch) of each name: an F feeds the F of the next
+    // virtual stage, the last one the first B; a B feeds the previous one
+    if (interleaved)
+    {
+        int lastVirtual = m * vpSize - 1;
+        for (auto &it : nodes)
+        {
+            const std::string &id = it.first;
+            int virtualIdx = virtualStage(id, m, vpSize);
+            if (virtualIdx < 0)
+                continue;
+            std::string prefix = id.substr(0, id.find_first_not_of("0123456789"));
+            std::string nextID = id.find('B') != std::string::npos ? (virtualIdx == 0 ? "" : incrementNodeID(id))
+                                 : virtualIdx == lastVirtual  ? prefix + "B0"
+                                                              : prefix + "F" + std::to_string(virtualIdx + 1);
+            std::vector<std::string> &dependencies = it.second.causalDependencies;
+            if (nodes.count(nextID) && std::find(dependencies.begin(), dependencies.end(), nextID) == dependencies.end())
+                it.second.addCausalDependency(nextID);
+        }
+    }
+
     if (nodeNum == expectNodeNum)
     {
         Node endNode;
@@ -353,8 +545,9 @@ bool Graph::buildComputationGraph(double threshold, PP_Rank_info pp_rank_info, s
         if (hangProcess != "")
         {
             std::vector<NCCLLog> logs = historyLogs[hangRank.id];
-            std::cout << "TYPE: hang, RANK: " << hangRank.id << ", " << "ITERATION: " << iteration << ", " << "PROCESS: " << hangProcess << ", "
-                      << "FUNCTION: " << logs.back().ncclFunction << ", LATENCY: -1" << ", ISCRITICAL: 0" << std::endl;
+            Finding("hang").rank(hangRank.id).add("ITERATION", iteration).add("PROCESS", hangProcess)
+                .add("FUNCTION", logs.back().ncclFunction).add("LATENCY", -1).add("ISCRITICAL", false)
+                .data("slack", 0).data("confidence", 1).emit();
         }
     }
 
@@ -454,6 +647,7 @@ void Graph::calculateCriticalPath()
     // mark critical nodes
     for (const auto &[id, node] : nodes)
     {
+        nodes[id].slack = latestStart[id] - earliestStart[id];
         if (earliestStart[id] == latestStart[id])
         {
             nodes[id].isCriticalNode = true;
@@ -461,8 +655,20 @@ void Graph::calculateCriticalPath()
     }
 }
 
-void Graph::checkSlow(std::vector<std::vector<NCCLLog>> historyLogs)
+SlowRecord::SlowRecord(int rank, int iteration, const std::string &processID, const std::string &ncclFunction,
+                       double latency, double startTime, double endTime, bool isCritical)
+    : rank(rank),
+      iteration(iteration),
+      processID(processID),
+      ncclFunction(ncclFunction),
+      latency(latency),
+      startTime(startTime),
+      endTime(endTime),
+      isCritical(isCritical) {}
+
+std::vector<SlowRecord> Graph::checkSlow(std::vector<std::vector<NCCLLog>> historyLogs)
 {
+    std::vector<SlowRecord> slowRecords;
     for (auto &it : nodes)
     {
         if (it.second.isSlowNode)
@@ -479,9 +685,15 @@ void Graph::checkSlow(std::vector<std::vector<NCCLLog>> historyLogs)
                     ncclFunction = logs[i - 1].ncclFunction;
                 }
             }
-            std::cout << "TYPE: slow, RANK: " << it.second.rank.id << ", " << "ITERATION: " << iteration << ", " << "PROCESS: " << it.second.processID << ", FUNCTION: " << ncclFunction << ", LATENCY: " << maxSize << ", ISCRITICAL: " << it.second.isCriticalNode << std::endl;
+            Finding("slow").rank(it.second.rank.id).add("ITERATION", iteration).add("PROCESS", it.second.processID)
+                .add("FUNCTION", ncclFunction).add("LATENCY", maxSize).add("ISCRITICAL", it.second.isCriticalNode)
+                .data("duration", it.second.duration).data("expected", it.second.expected)
+                .data("slack", it.second.slack).data("confidence", it.second.confidence).emit();
+            slowRecords.emplace_back(it.second.rank.id, iteration, it.second.processID, ncclFunction, maxSize,
+                                     it.second.startTime, it.second.endTime, it.second.isCriticalNode);
         }
     }
+    return slowRecords;
 }
 
 std::string Graph::extractPrefixRegex(const std::string &input)
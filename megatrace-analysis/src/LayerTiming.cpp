@@ -0,0 +1,178 @@
+#include "LayerTiming.hpp"
+#include "Findings.hpp"
+#include <iostream>
+#include <algorithm>
+#include <iomanip>
+#include <unordered_map>
+
+void fillLayerTiming(Iteration &iteration, const Rank &rank, const TrainingProcess &process,
+                     const std::vector<NCCLLog> &logs, const TrainingConfig &config)
+{
+    int batch;
+    char direction;
+    if (!parseProcessName(process.name, batch, direction) || process.startIdx < 1 || process.endIdx > logs.size())
+        return;
+    int layers = config.layers / (config.ppSize * config.vpSize);
+    bool isSP = config.isSP;
+    // one row per (microbatch, chunk)
+    int chunk = virtualStage(process.name, config.ppSize, config.vpSize) / config.ppSize;
+    batch = (batch - 1) * config.vpSize + chunk + 1;
+    TP_Rank_info &info = iteration.TP_info[rank.getTpGroup()];
+    if (batch >= (int)info.Rank_FW_time.size())
+        return;
+
+    const std::string marker = isSP ? "ncclReduceScatter" : "ncclAllReduce";
+    std::unordered_map<std::string, std::vector<size_t>> streamMarkers;
+    for (size_t i = process.startIdx - 1; i < process.endIdx; i++)
+        if (logs[i].ncclFunction == marker)
+            streamMarkers[logs[i].streamID].push_back(i);
+    auto busiest = std::max_element(streamMarkers.begin(), streamMarkers.end(), [](const auto &a, const auto &b)
+                                    { return a.second.size() < b.second.size(); });
+    if (busiest == streamMarkers.end() || busiest->second.size() < (size_t)layers * 2)
+        return;
+
+    // extra TP collectives around the layers: the first stage's embedding
+    // AllReduce comes first, the last stage's loss AllReduces come after the
+    // forward layers, and in SP mode only AllGathers trail the layers
+    const std::vector<size_t> &markers = busiest->second;
+    bool takeFirst = direction == 'F' && (isSP || rank.getIsLastPp());
+    size_t offset = takeFirst ? 0 : markers.size() - layers * 2;
+
+    std::vector<std::vector<std::vector<double>>> &times = direction == 'F' ? info.Rank_FW_time : info.Rank_BW_time;
+    int tp = rank.getTp();
+    times[batch][0][tp] = logs[process.startIdx - 1].timestamp;
+    for (int k = 1; k <= layers * 2; k++)
+        times[batch][k][tp] = logs[markers[offset + k - 1]].timestamp;
+
+    if (!isSP)
+        return;
+    // the AllGathers of a sublayer precede its ReduceScatter
+    TP_Rank_SP_info &spInfo = iteration.TP_SP_info[rank.getTpGroup()];
+    for (int k = 1; k <= layers * 2; k++)
+    {
+        size_t pos = markers[offset + k - 1];
+        size_t from = offset + k > 1 ? markers[offset + k - 2] + 1 : process.startIdx - 1;
+        std::vector<double> gathers;
+        for (size_t i = from; i < pos; i++)
+            if (logs[i].ncclFunction == "ncclAllGather" && logs[i].streamID == busiest->first)
+                gathers.push_back(logs[i].timestamp);
+        if (direction == 'F')
+        {
+            spInfo.Rank_FW_rs_time[batch][k][tp] = logs[pos].timestamp;
+            if (!gathers.empty())
+                spInfo.Rank_FW_ag_time[batch][k][tp] = gathers.back();
+        }
+        else
+        {
+            spInfo.Rank_BW_rs_time[batch][k][tp] = logs[pos].timestamp;
+            if (gathers.size() >= 2)
+                spInfo.Rank_BW_ag1_time[batch][k][tp] = gathers[gathers.size() - 2];
+            if (!gathers.empty())
+                spInfo.Rank_BW_ag2_time[batch][k][tp] = gathers.back();
+        }
+    }
+}
+
+void writeLayerHeader(std::ofstream &outFile)
+{
+    outFile << "Iteration,TPGroup,Rank,Stage,Layer,Direction,Samples,Mean,PeerMean,SlowFraction" << std::endl;
+}
+
+void reportLayerTiming(std::ofstream &outFile, const Iteration &iteration, Rank *ranks,
+                       const TrainingConfig &config, const std::set<int> &excluded)
+{
+    int tpSize = config.tpSize;
+    int vpSize = config.vpSize;
+    int layers = config.layers / (config.ppSize * vpSize);
+    if (tpSize < 2 || layers < 1 || excluded.count(iteration.iter))
+        return;
+
+    // TP group -> global rank of every TP index
+    std::vector<std::vector<int>> groupRanks(iteration.TP_info.size(), std::vector<int>(tpSize, -1));
+    for (int i = 0; i < config.numRanks; i++)
+        if (ranks[i].getTpGroup() < (int)groupRanks.size() && ranks[i].getTp() < tpSize)
+            groupRanks[ranks[i].getTpGroup()][ranks[i].getTp()] = i;
+
+    outFile << std::fixed << std::setprecision(6);
+    for (size_t g = 0; g < iteration.TP_info.size(); g++)
+    {
+        const TP_Rank_info &info = iteration.TP_info[g];
+        std::vector<int> slowLayers(tpSize, 0), measuredLayers(tpSize, 0);
+        std::vector<double> mineTotal(tpSize, 0), peersTotal(tpSize, 0);
+        for (int d = 0; d < 2 * vpSize; d++)
+        {
+            const auto &times = d % 2 == 0 ? info.Rank_FW_time : info.Rank_BW_time;
+            int chunk = d / 2;
+            for (int l = 0; l < layers; l++)
+            {
+                std::vector<double> mine(tpSize, 0), peers(tpSize, 0);
+                std::vector<int> slow(tpSize, 0);
+                int samples = 0;
+                for (size_t b = chunk + 1; b < times.size(); b += vpSize)
+                {
+                    std::vector<double> interval(tpSize);
+                    double sum = 0;
+                    bool valid = true;
+                    for (int tp = 0; tp < tpSize && valid; tp++)
+                    {
+                        double start = times[b][l * 2][tp], end = times[b][l * 2 + 2][tp];
+                        valid = start != 0 && end > start;
+                        interval[tp] = end - start;
+                        sum += interval[tp];
+                    }
+                    if (!valid)
+                        continue;
+                    samples++;
+                    for (int tp = 0; tp < tpSize; tp++)
+                    {
+                        double peerMean = (sum - interval[tp]) / (tpSize - 1);
+                        mine[tp] += interval[tp];
+                        peers[tp] += peerMean;
+                        slow[tp] += interval[tp] > config.layerSlowRatio * peerMean;
+                    }
+                }
+                if (samples == 0)
+                    continue;
+
+                for (int tp = 0; tp < tpSize; tp++)
+                {
+                    int id = groupRanks[g][tp];
+                    if (id < 0)
+                        continue;
+                    int stage = ranks[id].getPp();
+                    // backward walks the layers in reverse
+                    int layer = (chunk * config.ppSize + stage) * layers + (d % 2 == 0 ? l : layers - 1 - l);
+                    double fraction = (double)slow[tp] / samples;
+                    double latency = mine[tp] / samples, peer = peers[tp] / samples;
+                    outFile << iteration.iter << "," << g << "," << id << "," << stage << "," << layer << ","
+                            << (d % 2 == 0 ? "F" : "B") << "," << samples << "," << latency << ","
+                            << peer << "," << fraction << std::endl;
+                    if (samples < 2)
+                        continue;
+                    measuredLayers[tp]++;
+                    mineTotal[tp] += latency;
+                    peersTotal[tp] += peer;
+                    // consistently slower: in at least half of the microbatches,
+                    // and by enough on average to rise above host-issue jitter
+                    if (fraction >= 0.5 && latency > config.layerSlowRatio * peer && latency - peer >= config.layerMinExcess)
+                    {
+                        slowLayers[tp]++;
+                        Finding("slow-layer").rank(id).add("ITERATION", iteration.iter).add("LAYER", layer)
+                            .add("DIRECTION", d % 2 == 0 ? "F" : "B").add("LATENCY", latency)
+                            .add("PEER", peer).data("confidence", fraction).emit();
+                    }
+                }
+            }
+        }
+        // a GPU slow on most of its layers, and slower over all of them,
+        // points at the device, not the layer
+        for (int tp = 0; tp < tpSize; tp++)
+        {
+            if (groupRanks[g][tp] >= 0 && slowLayers[tp] > 0 && slowLayers[tp] * 2 >= measuredLayers[tp] &&
+                mineTotal[tp] > config.layerSlowRatio * peersTotal[tp])
+                Finding("slow-gpu").rank(groupRanks[g][tp]).add("ITERATION", iteration.iter)
+                    .add("SLOWLAYERS", std::to_string(slowLayers[tp]) + "/" + std::to_string(measuredLayers[tp]))
+                    .data("confidence", (double)slowLayers[tp] / measuredLayers[tp]).emit();
+        }
+    }
+}
@@ -0,0 +1,317 @@
+#include "LinkMatrix.hpp"
+#include "Findings.hpp"
+#include "LogParser.hpp"
+#include "GraphNode.hpp"
+#include "Rank.hpp"
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+#include <thread>
+#include <stack>
+#include <cmath>
+#include <chrono>
+#include <iomanip>
+
+// links carrying less than this per window are too sparse to compare
+static const long long MIN_LINK_BYTES = 1 << 20;
+
+static const char *FUNC_NAMES[] = {"ncclFuncBroadcast", "ncclFuncReduce", "ncclFuncAllGather",
+                                   "ncclFuncReduceScatter", "ncclFuncAllReduce", "ncclFuncSendRecv",
+                                   "ncclFuncSend", "ncclFuncRecv"};
+
+LinkStat::LinkStat()
+    : requests(0),
+      bytes(0),
+      busyTime(0),
+      maxLatency(0) {}
+
+void LinkStat::add(const TelemetryRecord &record)
+{
+    double latency = record.endTime - record.startTime;
+    requests++;
+    bytes += record.bytes;
+    busyTime += latency;
+    maxLatency = std::max(maxLatency, latency);
+}
+
+void LinkStat::merge(const LinkStat &other)
+{
+    requests += other.requests;
+    bytes += other.bytes;
+    busyTime += other.busyTime;
+    maxLatency = std::max(maxLatency, other.maxLatency);
+}
+
+// same definition as rate_from_log.py: bytes over the summed request time
+double LinkStat::gbps() const
+{
+    return busyTime > 0 ? bytes * 8 / busyTime / 1e9 : 0;
+}
+
+double LinkStat::avgLatency() const
+{
+    return requests > 0 ? busyTime / requests : 0;
+}
+
+LinkMatrix::LinkMatrix(double window)
+    : window(window) {}
+
+void LinkMatrix::add(const TelemetryRecord &record)
+{
+    long windowIndex = (long)std::floor(record.startTime / window);
+    links[LinkKey(windowIndex, record.srcIP, record.dstIP)].add(record);
+    flows[FlowKey(record.groupHash, record.func, record.funcTimes)].insert({record.fromRank, record.toRank});
+    rankIPs[{record.commHash, record.fromRank}].insert(record.srcIP);
+}
+
+void LinkMatrix::merge(const LinkMatrix &other)
+{
+    for (const auto &link : other.links)
+        links[link.first].merge(link.second);
+    for (const auto &flow : other.flows)
+        flows[flow.first].insert(flow.second.begin(), flow.second.end());
+    for (const auto &rankIP : other.rankIPs)
+        rankIPs[rankIP.first].insert(rankIP.second.begin(), rankIP.second.end());
+}
+
+SlowLink::SlowLink(long windowIndex, const std::string &srcIP, const std::string &dstIP, double gbps, double median)
+    : windowIndex(windowIndex),
+      srcIP(srcIP),
+      dstIP(dstIP),
+      gbps(gbps),
+      median(median) {}
+
+// Tarjan's strongly connected components, iterative so large rings do not
+// exhaust the stack. Only components with more than one rank are cycles.
+std::vector<std::vector<int>> findCycles(const std::set<std::pair<int, int>> &edges)
+{
+    std::map<int, std::vector<int>> graph;
+    for (const auto &edge : edges)
+    {
+        graph[edge.first].push_back(edge.second);
+        graph[edge.second];
+    }
+
+    std::map<int, int> index, lowlink;
+    std::set<int> onStack;
+    std::vector<int> stack;
+    std::vector<std::vector<int>> cycles;
+    int counter = 0;
+
+    for (const auto &vertex : graph)
+    {
+        if (index.count(vertex.first))
+            continue;
+        // (vertex, next neighbour to visit)
+        std::stack<std::pair<int, size_t>> callStack;
+        callStack.push({vertex.first, 0});
+        index[vertex.first] = lowlink[vertex.first] = counter++;
+        stack.push_back(vertex.first);
+        onStack.insert(vertex.first);
+        while (!callStack.empty())
+        {
+            int v = callStack.top().first;
+            size_t &next = callStack.top().second;
+            if (next < graph[v].size())
+            {
+                int w = graph[v][next++];
+                if (!index.count(w))
+                {
+                    index[w] = lowlink[w] = counter++;
+                    stack.push_back(w);
+                    onStack.insert(w);
+                    callStack.push({w, 0});
+                }
+                else if (onStack.count(w))
+                {
+                    lowlink[v] = std::min(lowlink[v], index[w]);
+                }
+                continue;
+            }
+            callStack.pop();
+            if (!callStack.empty())
+                lowlink[callStack.top().first] = std::min(lowlink[callStack.top().first], lowlink[v]);
+            if (lowlink[v] == index[v])
+            {
+                std::vector<int> cycle;
+                int w;
+                do
+                {
+                    w = stack.back();
+                    stack.pop_back();
+                    onStack.erase(w);
+                    cycle.push_back(w);
+                } while (w != v);
+                if (cycle.size() > 1)
+                {
+                    std::reverse(cycle.begin(), cycle.end());
+                    cycles.push_back(cycle);
+                }
+            }
+        }
+    }
+    return cycles;
+}
+
+// A link is slow when it runs below ratio * the median bandwidth of all
+// links active in the same window.
+std::vector<SlowLink> findSlowLinks(const LinkMatrix &matrix, double ratio)
+{
+    std::vector<SlowLink> slowLinks;
+    auto it = matrix.links.begin();
+    while (it != matrix.links.end())
+    {
+        long windowIndex = std::get<0>(it->first);
+        std::vector<std::map<LinkKey, LinkStat>::const_iterator> window;
+        for (; it != matrix.links.end() && std::get<0>(it->first) == windowIndex; ++it)
+            if (it->second.bytes >= MIN_LINK_BYTES)
+                window.push_back(it);
+        if (window.size() < 3)
+            continue;
+
+        std::vector<double> rates;
+        for (const auto &link : window)
+            rates.push_back(link->second.gbps());
+        std::nth_element(rates.begin(), rates.begin() + rates.size() / 2, rates.end());
+        double median = rates[rates.size() / 2];
+
+        for (const auto &link : window)
+        {
+            if (link->second.gbps() < ratio * median)
+                slowLinks.emplace_back(windowIndex, std::get<1>(link->first), std::get<2>(link->first),
+                                       link->second.gbps(), median);
+        }
+    }
+    return slowLinks;
+}
+
+static void writeLinkMatrix(const std::string &filename, const LinkMatrix &matrix)
+{
+    std::ofstream outFile(filename, std::ios::out);
+    if (!outFile.is_open())
+    {
+        std::cerr << "Failed to open file: " << filename << std::endl;
+        return;
+    }
+    outFile << "Window,WindowStart,SrcIP,DstIP,Requests,Bytes,Gbps,AvgLatencyUs,MaxLatencyUs" << std::endl;
+    outFile << std::fixed << std::setprecision(3);
+    for (const auto &link : matrix.links)
+    {
+        outFile << std::get<0>(link.first) << "," << std::get<0>(link.first) * matrix.window << ","
+                << std::get<1>(link.first) << "," << std::get<2>(link.first) << ","
+                << link.second.requests << "," << link.second.bytes << "," << link.second.gbps() << ","
+                << link.second.avgLatency() * 1e6 << "," << link.second.maxLatency * 1e6 << std::endl;
+    }
+    outFile.close();
+}
+
+static void writeCycles(const std::string &filename, const LinkMatrix &matrix)
+{
+    std::ofstream outFile(filename, std::ios::out);
+    if (!outFile.is_open())
+    {
+        std::cerr << "Failed to open file: " << filename << std::endl;
+        return;
+    }
+    for (const auto &flow : matrix.flows)
+    {
+        int func = std::get<1>(flow.first);
+        const char *funcName = (func >= 0 && func < (int)(sizeof(FUNC_NAMES) / sizeof(FUNC_NAMES[0]))) ? FUNC_NAMES[func] : "Unknown";
+        for (const auto &cycle : findCycles(flow.second))
+        {
+            outFile << "Detected cycle in group " << std::get<0>(flow.first) << ", func " << funcName
+                    << ", func_time " << std::get<2>(flow.first) << ": ";
+            for (size_t i = 0; i < cycle.size(); i++)
+                outFile << (i ? " -> " : "") << cycle[i];
+            outFile << std::endl;
+        }
+    }
+    outFile.close();
+}
+
+// Maps every global rank to the source IPs it sent from, using the comm
+// membership the workers saw while parsing the Megatrace logs (or store).
+static std::map<int, std::set<std::string>> mapRankIPs(const LinkMatrix &matrix)
+{
+    std::unordered_map<std::string, std::vector<int>> members = getCommMembers();
+
+    std::map<int, std::set<std::string>> globalIPs;
+    for (const auto &rankIP : matrix.rankIPs)
+    {
+        auto it = members.find(rankIP.first.first);
+        int commRank = rankIP.first.second;
+        if (it == members.end() || commRank < 0 || commRank >= (int)it->second.size())
+            continue;
+        globalIPs[it->second[commRank]].insert(rankIP.second.begin(), rankIP.second.end());
+    }
+    return globalIPs;
+}
+
+int runTelemetryAnalysis(const std::string &telemetryDir, TrainingConfig &config)
+{
+    auto start_time = std::chrono::high_resolution_clock::now();
+    std::vector<std::string> files = listTelemetryFiles(telemetryDir);
+    if (files.empty())
+    {
+        std::cerr << "No telemetry files found in " << telemetryDir << std::endl;
+        return 1;
+    }
+
+    // one partial matrix per parsing thread, merged once at the end
+    std::vector<LinkMatrix> partials(std::max(1u, std::thread::hardware_concurrency()), LinkMatrix(config.telemetryWindow));
+    parseTelemetryFiles(files, [&](int threadID, std::vector<TelemetryRecord> &records)
+                        {
+        for (const auto &record : records)
+            partials[threadID].add(record); });
+    LinkMatrix matrix(config.telemetryWindow);
+    for (const auto &partial : partials)
+        matrix.merge(partial);
+
+    auto duration = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start_time).count();
+    std::cout << "Telemetry: " << files.size() << " files, " << matrix.links.size() << " link windows, "
+              << duration << " seconds" << std::endl;
+
+    writeLinkMatrix(config.outputDicPath + "/" + "link-matrix.csv", matrix);
+    writeCycles(config.outputDicPath + "/" + "rank-cycles.txt", matrix);
+
+    std::vector<SlowLink> slowLinks = findSlowLinks(matrix, config.linkSlowRatio);
+    openFindingReport(config.outputDicPath + "/" + "findings.ndjson", nullptr, 0);
+    for (const auto &link : slowLinks)
+    {
+        Finding("link").add("SRC", link.srcIP).add("DST", link.dstIP).add("WINDOW", link.windowIndex * matrix.window)
+            .add("BANDWIDTH", link.gbps).add("MEDIAN", link.median).emit();
+    }
+
+    if (config.inputFilePath.empty())
+    {
+        closeFindingReport();
+        return 0;
+    }
+
+    // run the regular analysis to collect slow nodes, then report the slow
+    // links that touch a slow rank while it was slow
+    Rank *ranks = initRanks(config);
+    initParser(ranks, config);
+    releaseRanks(ranks, config);
+
+    std::map<int, std::set<std::string>> globalIPs = mapRankIPs(matrix);
+    for (const auto &slow : getSlowRecords())
+    {
+        auto ips = globalIPs.find(slow.rank);
+        if (ips == globalIPs.end())
+            continue;
+        for (const auto &link : slowLinks)
+        {
+            double windowStart = link.windowIndex * matrix.window;
+            if (windowStart > slow.endTime || windowStart + matrix.window < slow.startTime)
+                continue;
+            if (!ips->second.count(link.srcIP) && !ips->second.count(link.dstIP))
+                continue;
+            Finding("slow-link").rank(slow.rank).add("ITERATION", slow.iteration).add("PROCESS", slow.processID)
+                .add("SRC", link.srcIP).add("DST", link.dstIP).add("BANDWIDTH", link.gbps).add("MEDIAN", link.median)
+                .add("ISCRITICAL", slow.isCritical).emit();
+        }
+    }
+    closeFindingReport();
+    return 0;
+}
@@ -0,0 +1,156 @@
+#include "LiveMonitor.hpp"
+#include "Findings.hpp"
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <thread>
+#include <chrono>
+#include <map>
+
+StreamProgress::StreamProgress()
+    : seq(0),
+      last(),
+      lastIndex(0),
+      reduceScatter(false),
+      lastReduceScatter(0),
+      p2p(false) {}
+
+RankProgress::RankProgress()
+    : lastTime(0),
+      records(0) {}
+
+LiveMonitor::LiveMonitor(int numRanks, double deadline)
+    : deadline(deadline),
+      ranks(numRanks),
+      records(0),
+      stop(false) {}
+
+void LiveMonitor::record(int rank, const NCCLLog &log)
+{
+    RankProgress &progress = ranks[rank];
+    {
+        std::lock_guard<std::mutex> guard(progress.lock);
+        progress.lastTime = log.timestamp;
+        StreamProgress &stream = progress.streams[log.commHash.empty() ? "stream " + log.streamID : log.commHash];
+        stream.seq++;
+        stream.last = log;
+        stream.lastIndex = progress.records++;
+        if (log.ncclFunction == "ncclReduceScatter")
+        {
+            stream.reduceScatter = true;
+            stream.lastReduceScatter = stream.lastIndex;
+        }
+        stream.p2p |= log.ncclFunction == "ncclSend" || log.ncclFunction == "ncclRecv";
+    }
+    records.fetch_add(1, std::memory_order_relaxed);
+}
+
+void LiveMonitor::watch(const TrainingConfig &config, Rank *rankInfo, const std::atomic<int> &terminated)
+{
+    auto interval = std::chrono::duration<double>(std::min(deadline / 4, 0.1));
+    uint64_t frontier = records.load();
+    auto advanced = std::chrono::steady_clock::now();
+    while (terminated.load() < config.numRanks)
+    {
+        std::this_thread::sleep_for(interval);
+        uint64_t current = records.load();
+        auto now = std::chrono::steady_clock::now();
+        // the clock runs from the start, so a job that hangs before its
+        // first record, or a directory that stays empty, still expires
+        if (current != frontier)
+        {
+            frontier = current;
+            advanced = now;
+            continue;
+        }
+        if (std::chrono::duration<double>(now - advanced).count() < deadline)
+            continue;
+        Finding("live-hang").add("RECORDS", frontier).add("DEADLINE", deadline).emit();
+        snapshot(config, rankInfo);
+        stop = true;
+        return;
+    }
+}
+
+void LiveMonitor::snapshot(const TrainingConfig &config, Rank *rankInfo)
+{
+    struct Member
+    {
+        int rank;
+        const StreamProgress *stream;
+    };
+    // group -> member ranks; untagged streams take their role as in
+    // sequenceGroups: the one with the most records is TP, the one with the
+    // latest ReduceScatter DP
+    std::map<std::string, std::vector<Member>> groups;
+    std::vector<std::unordered_map<std::string, StreamProgress>> copies(config.numRanks);
+    std::vector<double> lastTime(config.numRanks);
+    for (int r = 0; r < config.numRanks; r++)
+    {
+        std::lock_guard<std::mutex> guard(ranks[r].lock);
+        copies[r] = ranks[r].streams;
+        lastTime[r] = ranks[r].lastTime;
+    }
+    for (int r = 0; r < config.numRanks; r++)
+    {
+        std::string tp = "tp" + std::to_string(rankInfo[r].getTpGroup());
+        std::string dp = "dp" + std::to_string(rankInfo[r].getDpGroup());
+        const StreamProgress *tpStream = nullptr, *dpStream = nullptr;
+        for (const auto &it : copies[r])
+        {
+            const StreamProgress &stream = it.second;
+            if (!stream.last.commHash.empty())
+            {
+                if (!stream.p2p)
+                    groups[it.first].push_back({r, &stream});
+                continue;
+            }
+            if (tpStream == nullptr || stream.seq > tpStream->seq ||
+                (stream.seq == tpStream->seq && stream.lastIndex < tpStream->lastIndex))
+                tpStream = &stream;
+            if (stream.reduceScatter && (dpStream == nullptr || stream.lastReduceScatter > dpStream->lastReduceScatter))
+                dpStream = &stream;
+        }
+        if (tpStream != nullptr && tpStream->p2p)
+            tpStream = nullptr;
+        if (dpStream == tpStream || (dpStream != nullptr && dpStream->p2p))
+            dpStream = nullptr;
+        // ranks that never issued on the group still belong to it
+        groups[tp].push_back({r, tpStream});
+        if (config.dpSize > 1)
+            groups[dp].push_back({r, dpStream});
+    }
+
+    std::ofstream outFile(config.outputDicPath + "/" + "hang-snapshot.txt", std::ios::out);
+    outFile << std::fixed << std::setprecision(6);
+    for (const auto &group : groups)
+    {
+        const std::vector<Member> &members = group.second;
+        const StreamProgress *frontier = nullptr;
+        for (const auto &member : members)
+            if (member.stream != nullptr && (frontier == nullptr || member.stream->seq > frontier->seq))
+                frontier = member.stream;
+        if (frontier == nullptr)
+            continue;
+        std::string inside, missing;
+        std::vector<int> insideRanks;
+        for (const auto &member : members)
+        {
+            if (member.stream != nullptr && member.stream->seq == frontier->seq)
+            {
+                inside += (inside.empty() ? "" : "/") + std::to_string(member.rank);
+                insideRanks.push_back(member.rank);
+                continue;
+            }
+            missing += (missing.empty() ? "" : "/") + std::to_string(member.rank) + "@" +
+                       (member.stream ? std::to_string(member.stream->seq) + ":" + member.stream->last.ncclFunction : "0");
+        }
+        outFile << group.first << " seq " << frontier->seq << " " << frontier->last.ncclFunction
+                << " inside " << inside << " missing " << (missing.empty() ? "-" : missing) << std::endl;
+        if (!missing.empty())
+            Finding("live-hang").add("GROUP", group.first).add("SEQ", frontier->seq)
+                .add("FUNCTION", frontier->last.ncclFunction).add("INSIDE", insideRanks).add("MISSING", missing).emit();
+    }
+    for (int r = 0; r < config.numRanks; r++)
+        outFile << "rank " << r << " last " << lastTime[r] << std::endl;
+}
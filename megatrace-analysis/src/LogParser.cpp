@@ -2,8 +2,27 @@
 #include "Rank.hpp"
 #include "GraphNode.hpp"
 #include "Semaphore.hpp"
+#include "Telemetry.hpp"
+#include "CollectiveMatcher.hpp"
+#include "PipelineBubble.hpp"
+#include "LayerTiming.hpp"
+#include "TimeBreakdown.hpp"
+#include "DriftDetector.hpp"
+#include "OpSequence.hpp"
+#include "LiveMonitor.hpp"
+#include "Replay.hpp"
+#include "TraceStore.hpp"
+#include "ChromeTrace.hpp"
+#include "GanttChart.hpp"
+#include "OutputSink.hpp"
+#include "Findings.hpp"
+#include "Triage.hpp"
+#include "Checkpoint.hpp"
+#include "PatternLearner.hpp"
+#include "AllToAll.hpp"
 #include <iostream>
 #include <fstream>
+#include <sstream>
 #include <regex>
 #include <algorithm>
 #include <mutex>
@@ -12,18 +31,21 @@
 #include <climits>
 #include <condition_variable>
 #include <unordered_map>
+#include <unordered_set>
+#include <set>
 #include <chrono>
 #include <atomic>
 #include <queue>
 #include <sys/time.h>
 #include <unistd.h>
 #include <iomanip> 
+#include <filesystem>
 
 NCCLLog::NCCLLog(double ts,
                  std::string &sid,
                  double lat,
                  int rank,
-                 int sz,
+                 long long sz,
                  int iter,
                  const std::string &func,
                  const std::string &proc)
@@ -34,7 +56,9 @@ NCCLLog::NCCLLog(double ts,
       size(sz),
       iteration(iter),
       ncclFunction(func),
-      process(proc) {}
+      process(proc),
+      commHash(""),
+      opCount(0) {}
 
 NCCLLog::NCCLLog()
     : timestamp(0),
@@ -44,7 +68,9 @@ NCCLLog::NCCLLog()
       size(0),
       iteration(-1),
       ncclFunction(""),
-      process("") {}
+      process(""),
+      commHash(""),
+      opCount(0) {}
 
 std::mutex mtx;
 bool terminateFlag = false;
@@ -54,6 +80,54 @@ std::vector<Iteration> iterations;
 std::vector<int> iter_finished_state;
 Semaphore sm(0);
 Semaphore tm(0);
+std::vector<SlowRecord> slowRecords;
+// set in live-tail mode (liveDeadline > 0)
+LiveMonitor *liveMonitor = nullptr;
+// set when the input is a .mtc store instead of a log directory
+TraceStore *traceStore = nullptr;
+// triage mode (triageTopK > 0): the PP groups that get workers; empty for all
+std::vector<bool> deepGroups;
+// ranks with a worker thread
+int workerNum = 0;
+// checkpointPath: iterations[0] is firstIteration, the ones before were
+// closed by an earlier run; workers start at resumePoints and log where
+// every iteration they read began in boundaryPoints
+size_t firstIteration = 1;
+std::vector<ResumePoint> resumePoints;
+std::vector<std::vector<ResumePoint>> boundaryPoints;
+
+static Iteration &iterationAt(size_t iter)
+{
+    return iterations[iter - firstIteration];
+}
+
+const std::vector<SlowRecord> &getSlowRecords()
+{
+    return slowRecords;
+}
+
+// commHash -> global ranks, filled by the workers the first time a rank
+// issues on a comm
+std::mutex commMutex;
+std::unordered_map<std::string, std::set<int>> commRanks;
+
+static void addCommMember(std::unordered_set<std::string> &seen, const NCCLLog &log, int workerID)
+{
+    if (log.commHash.empty() || !seen.insert(log.commHash).second)
+        return;
+    std::lock_guard<std::mutex> lock(commMutex);
+    commRanks[log.commHash].insert(workerID);
+}
+
+std::unordered_map<std::string, std::vector<int>> getCommMembers()
+{
+    std::lock_guard<std::mutex> lock(commMutex);
+    std::unordered_map<std::string, std::vector<int>> members;
+    for (const auto &comm : commRanks)
+        members[comm.first].assign(comm.second.begin(), comm.second.end());
+    return members;
+}
+
 std::string subtractFromTimestamp(const std::string& timestampStr, const std::string& subtractStr) {
     // Find the decimal point positions
     size_t decimalPos1 = timestampStr.find('.');
@@ -102,7 +176,7 @@ std::string subtractFromTimestamp(const std::string& timestampStr, const std::st
 
 int parseLogs(const std::vector<std::string> &logs, std::vector<NCCLLog> &parsedLogs)
 {
-    std::regex logPattern(R"(\[(\d+\.?\d*)\]\s\[Rank\s(\d+)\]\sFun\s(\w+)\sData\s(\d+)\sstream\s(\w+))"); //  v3
+    std::regex logPattern(R"(\[(\d+\.?\d*)\]\s\[Rank\s(\d+)\]\sFun\s(\w+)\sData\s(\d+)\sstream\s(\w+)(?:\scomm\s(\w+)\sop\s(\d+))?)"); //  v4, comm/op optional for v3 logs
 
     for (const std::string &log : logs)
     {
@@ -116,8 +190,14 @@ int parseLogs(const std::vector<std::string> &logs, std::vector<NCCLLog> &parsed
             entry.timestamp = std::stod(adjustedTimestamp);
             entry.rankID = stoi(match[2].str());
             entry.ncclFunction = "nccl" + match[3].str();
+            entry.size = std::stoll(match[4].str());
 
             entry.streamID = match[5].str();
+            if (match[6].matched)
+            {
+                entry.commHash = match[6].str();
+                entry.opCount = std::stoull(match[7].str());
+            }
             parsedLogs.push_back(entry);
         }
         else
@@ -132,7 +212,7 @@ int parseLogs(const std::vector<std::string> &logs, std::vector<NCCLLog> &parsed
 NCCLLog parseLog(const std::string &log)
 {
 
-    std::regex logPattern(R"(\[(\d+\.?\d*)\]\s\[Rank\s(\d+)\]\sFun\s(\w+)\sData\s(\d+)\sstream\s(\w+))"); //  v3
+    std::regex logPattern(R"(\[(\d+\.?\d*)\]\s\[Rank\s(\d+)\]\sFun\s(\w+)\sData\s(\d+)\sstream\s(\w+)(?:\scomm\s(\w+)\sop\s(\d+))?)"); //  v4, comm/op optional for v3 logs
     std::smatch match;
     NCCLLog entry;
     if (regex_search(log, match, logPattern))
@@ -143,7 +223,13 @@ NCCLLog parseLog(const std::string &log)
         entry.timestamp = std::stod(adjustedTimestamp);
         entry.rankID = stoi(match[2].str());
         entry.ncclFunction = "nccl" + match[3].str();
+        entry.size = std::stoll(match[4].str());
         entry.streamID = match[5].str();
+        if (match[6].matched)
+        {
+            entry.commHash = match[6].str();
+            entry.opCount = std::stoull(match[7].str());
+        }
     }
     else
     {
@@ -265,20 +351,29 @@ int fetchLog(const std::string& filePath, std::streampos &lastPosition, NCCLLog
     file.open(filePath, std::ios::in);
     while (true)
     {
-        if (count++ == 1e5)
+        // live tail: wait for the writer until the watchdog stops us
+        if (liveMonitor == nullptr ? count++ == 1e5 : liveMonitor->stop.load())
         {
             break;
         }
         if (!file.is_open())
         {
-            std::cerr << "Error: Could not open file " << filePath << std::endl;
+            if (liveMonitor == nullptr)
+            {
+                std::cerr << "Error: Could not open file " << filePath << std::endl;
+                continue;
+            }
+            // the rank has not created its log yet
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            file.clear();
+            file.open(filePath, std::ios::in);
             continue;
         }
 
         file.seekg(lastPosition);
         std::string line;
 
-        if (getline(file, line))
+        if (getline(file, line) && (liveMonitor == nullptr || !file.eof()))
         {
             count = 0;
             lastPosition = file.tellg();
@@ -286,11 +381,28 @@ int fetchLog(const std::string& filePath, std::streampos &lastPosition, NCCLLog
             file.close();
             return 0;
         }
+        if (liveMonitor != nullptr)
+        {
+            // an unterminated line is still being written
+            file.clear();
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
     }
     file.close();
     return -1;
 }
 
+// reads from the mapped store when there is one; position is then a record index
+static int fetchRecord(const std::string &filePath, int rank, std::streampos &position, NCCLLog &log)
+{
+    if (traceStore == nullptr)
+        return fetchLog(filePath, position, log);
+    if (traceStore->fetch(rank, (std::streamoff)position, log))
+        return -1;
+    position += 1;
+    return 0;
+}
+
 void worker_withoutSP(const std::string &filePath, int workerID,
                       Rank rank, const TrainingConfig &config,
                       std::vector<TrainingProcess> trainingPattern)
@@ -302,6 +414,14 @@ void worker_withoutSP(const std::string &filePath, int workerID,
     std::streampos lastLogPosition = 0;
     std::vector<NCCLLog> logs;
     NCCLLog log;
+    double pendingRecvTime = 0;
+    std::unordered_set<std::string> comms;
+    if (!resumePoints.empty())
+    {
+        iterCnt = resumePoints[workerID].iteration;
+        lastLogPosition = resumePoints[workerID].position;
+        pendingRecvTime = resumePoints[workerID].pendingRecvTime;
+    }
 
     while (iterCnt <= config.iterations)
     {
@@ -311,19 +431,24 @@ void worker_withoutSP(const std::string &filePath, int workerID,
 
         {
             std::lock_guard<std::mutex> lock(mtx);
-            if (iterations.size() < iterCnt)
+            if (iterations.size() + firstIteration <= iterCnt)
             {
-                iterations.emplace_back(iterCnt, config.tpGroupSize, config.ppGroupSize, config.dpGroupSize, config.GBS, config.layers / config.ppSize, config.tpSize, config.ppSize, config.dpSize, config.numRanks);
+                iterations.emplace_back(iterCnt, config.tpGroupSize, config.ppGroupSize, config.dpGroupSize, config.epGroupSize, config.GBS / config.dpSize * config.vpSize, config.layers / (config.ppSize * config.vpSize), config.tpSize, config.ppSize, config.dpSize, config.epSize, config.numRanks, config.isSP);
             }
         }
 
-        if (fetchLog(filePath, lastLogPosition, log))
+        std::streampos recordPosition = lastLogPosition;
+        if (fetchRecord(filePath, workerID, lastLogPosition, log))
         {
             break;
         }
         else
         {
-            iterations[iterCnt - 1].historyLogs[workerID].push_back(log);
+            iterationAt(iterCnt).historyLogs[workerID].push_back(log);
+            iterationAt(iterCnt).opSequences[workerID][sequenceKey(log)].add(log, iterationAt(iterCnt).historyLogs[workerID].size() - 1);
+            if (liveMonitor != nullptr)
+                liveMonitor->record(workerID, log);
+            addCommMember(comms, log, workerID);
             logs.push_back(log);
         }
         logs.back().iteration = iterCnt;
@@ -336,21 +461,33 @@ void worker_withoutSP(const std::string &filePath, int workerID,
         {
             std::lock_guard<std::mutex> lck(mtx);
             iter_finished_state[iterCnt - 1]++;
-            if (iter_finished_state[iterCnt - 1] == config.numRanks)
+            if (iter_finished_state[iterCnt - 1] == workerNum)
             {
                 iter_finished_state[iterCnt - 1] = -1;
             }
             iterCnt++;
         }
 
+        if (logs.size() < cur_process.startIdx && (logs.back().ncclFunction == "ncclSend" || logs.back().ncclFunction == "ncclRecv"))
+        { // PP 边界的 send/recv: recv 属于下一个 process, send 属于上一个 process
+            if (logs.back().ncclFunction == "ncclRecv")
+                pendingRecvTime = logs.back().timestamp;
+            else if (processCnt != 0)
+            {
+                const TrainingProcess &prev_process = trainingPattern[processCnt - 1];
+                iterationAt(prev_process.iteration).PP_info[rank.getPpGroup()].nodes[rank.getPp()].back().sendTime = logs.back().timestamp;
+            }
+            continue;
+        }
+
         if (logs.size() < cur_process.startIdx && processCnt != 0)
         { // 识别DP
 
             if (logs.back().ncclFunction == "ncclReduceScatter")
-                iterations[iterCnt - 2].DP_info[rank.getDpGroup()].Rank_rs_time[rank.getDp()] = logs.back().timestamp;
-            else if (logs.back().ncclFunction == "ncclAllGather" && iterations[iterCnt - 2].DP_info[rank.getDpGroup()].Rank_ag_time[rank.getDp()] == 0)
+                iterationAt(iterCnt - 1).DP_info[rank.getDpGroup()].Rank_rs_time[rank.getDp()] = logs.back().timestamp;
+            else if (logs.back().ncclFunction == "ncclAllGather" && iterationAt(iterCnt - 1).DP_info[rank.getDpGroup()].Rank_ag_time[rank.getDp()] == 0)
             {
-                iterations[iterCnt - 2].DP_info[rank.getDpGroup()].Rank_ag_time[rank.getDp()] = logs.back().timestamp;
+                iterationAt(iterCnt - 1).DP_info[rank.getDpGroup()].Rank_ag_time[rank.getDp()] = logs.back().timestamp;
             }
 
             continue;
@@ -362,21 +499,32 @@ void worker_withoutSP(const std::string &filePath, int workerID,
             logs.back().process = cur_process.name;
 
             if (logs.size() == cur_process.startIdx)
-                iterations[iterCnt - 1].PP_info[rank.getPpGroup()].nodes[rank.getPp()].emplace_back(rank, logs.back().process, logs.back().iteration, logs.back().timestamp, 0);
+            {
+                if (processCnt == 0 || trainingPattern[processCnt - 1].iteration != cur_process.iteration)
+                    boundaryPoints[workerID].push_back({cur_process.iteration, recordPosition, pendingRecvTime});
+                iterationAt(iterCnt).PP_info[rank.getPpGroup()].nodes[rank.getPp()].emplace_back(rank, logs.back().process, logs.back().iteration, logs.back().timestamp, 0);
+                iterationAt(iterCnt).PP_info[rank.getPpGroup()].nodes[rank.getPp()].back().recvTime = pendingRecvTime;
+                pendingRecvTime = 0;
+            }
             else if (logs.size() == cur_process.endIdx)
             {
-                iterations[iterCnt - 1].PP_info[rank.getPpGroup()].nodes[rank.getPp()].back().endTime = logs.back().timestamp;
-                double duration = iterations[iterCnt - 1].PP_info[rank.getPpGroup()].nodes[rank.getPp()].back().calDuration();
+                iterationAt(iterCnt).PP_info[rank.getPpGroup()].nodes[rank.getPp()].back().endTime = logs.back().timestamp;
+                double duration = iterationAt(iterCnt).PP_info[rank.getPpGroup()].nodes[rank.getPp()].back().calDuration();
+                fillLayerTiming(iterationAt(iterCnt), rank, cur_process, logs, config);
+                fillAllToAll(iterationAt(iterCnt), rank, cur_process, logs);
                 processCnt++;
-                iterations[iterCnt - 1].PP_info[rank.getPpGroup()].timecost_sum += duration;
+                iterationAt(iterCnt).PP_info[rank.getPpGroup()].timecost_sum += duration;
             }
         }
     }
+    // every process read: the rank's last iteration is closed too
+    if (processCnt == trainingPattern.size())
+        boundaryPoints[workerID].push_back({config.iterations + 1, lastLogPosition, 0});
     std::cout << "rank:" << workerID << " finish" << std::endl;
     std::cout << config.outputDicPath << "/" << "ncclLog-rank-" << std::to_string(workerID) << ".txt" << std::endl;
     writeLogsToFile(config.outputDicPath + "/" + "ncclLog-rank-" + std::to_string(workerID) + ".txt", logs);
 
-    if (terminatingNum.fetch_add(1, std::memory_order_acq_rel) + 1 == config.numRanks)
+    if (terminatingNum.fetch_add(1, std::memory_order_acq_rel) + 1 == workerNum)
     {
         sm.Signal();
     }
@@ -395,6 +543,14 @@ void worker_withSP(const std::string &filePath, int workerID,
     std::streampos lastLogPosition = 0;
     std::vector<NCCLLog> logs;
     NCCLLog log;
+    double pendingRecvTime = 0;
+    std::unordered_set<std::string> comms;
+    if (!resumePoints.empty())
+    {
+        iterCnt = resumePoints[workerID].iteration;
+        lastLogPosition = resumePoints[workerID].position;
+        pendingRecvTime = resumePoints[workerID].pendingRecvTime;
+    }
 
     while (iterCnt <= config.iterations)
     {
@@ -403,20 +559,25 @@ void worker_withSP(const std::string &filePath, int workerID,
         TrainingProcess cur_process = trainingPattern[processCnt];
         {
             std::lock_guard<std::mutex> lock(mtx);
-            if (iterations.size() < iterCnt)
+            if (iterations.size() + firstIteration <= iterCnt)
             {
-                iterations.emplace_back(iterCnt, config.tpGroupSize, config.ppGroupSize, config.dpGroupSize, config.GBS, config.layers / config.ppSize, config.tpSize, config.ppSize, config.dpSize, config.numRanks);
+                iterations.emplace_back(iterCnt, config.tpGroupSize, config.ppGroupSize, config.dpGroupSize, config.epGroupSize, config.GBS / config.dpSize * config.vpSize, config.layers / (config.ppSize * config.vpSize), config.tpSize, config.ppSize, config.dpSize, config.epSize, config.numRanks, config.isSP);
             }
         }
 
-        if (fetchLog(filePath, lastLogPosition, log))
+        std::streampos recordPosition = lastLogPosition;
+        if (fetchRecord(filePath, workerID, lastLogPosition, log))
         {
             break;
         }
 
         else
         {
-            iterations[iterCnt - 1].historyLogs[workerID].push_back(log);
+            iterationAt(iterCnt).historyLogs[workerID].push_back(log);
+            iterationAt(iterCnt).opSequences[workerID][sequenceKey(log)].add(log, iterationAt(iterCnt).historyLogs[workerID].size() - 1);
+            if (liveMonitor != nullptr)
+                liveMonitor->record(workerID, log);
+            addCommMember(comms, log, workerID);
             logs.push_back(log);
         }
         logs.back().iteration = iterCnt;
@@ -429,7 +590,7 @@ void worker_withSP(const std::string &filePath, int workerID,
         {
             std::lock_guard<std::mutex> lck(mtx);
             iter_finished_state[iterCnt - 1]++;
-            if (iter_finished_state[iterCnt - 1] == config.numRanks)
+            if (iter_finished_state[iterCnt - 1] == workerNum)
             {
                 // sm.Signal();
                 iter_finished_state[iterCnt - 1] = -1;
@@ -437,16 +598,28 @@ void worker_withSP(const std::string &filePath, int workerID,
             iterCnt++;
         }
 
+        if (logs.size() < cur_process.startIdx && (logs.back().ncclFunction == "ncclSend" || logs.back().ncclFunction == "ncclRecv"))
+        { // PP 边界的 send/recv: recv 属于下一个 process, send 属于上一个 process
+            if (logs.back().ncclFunction == "ncclRecv")
+                pendingRecvTime = logs.back().timestamp;
+            else if (processCnt != 0)
+            {
+                const TrainingProcess &prev_process = trainingPattern[processCnt - 1];
+                iterationAt(prev_process.iteration).PP_info[rank.getPpGroup()].nodes[rank.getPp()].back().sendTime = logs.back().timestamp;
+            }
+            continue;
+        }
+
         if (logs.size() < cur_process.startIdx && processCnt != 0)
         { // 识别DP
             if (rank.id == 6)
             {
             }
             if (logs.back().ncclFunction == "ncclReduceScatter")
-                iterations[iterCnt - 2].DP_info[rank.getDpGroup()].Rank_rs_time[rank.getDp()] = logs.back().timestamp;
-            else if (logs.back().ncclFunction == "ncclAllGather" && iterations[iterCnt - 2].DP_info[rank.getDpGroup()].Rank_ag_time[rank.getDp()] == 0)
+                iterationAt(iterCnt - 1).DP_info[rank.getDpGroup()].Rank_rs_time[rank.getDp()] = logs.back().timestamp;
+            else if (logs.back().ncclFunction == "ncclAllGather" && iterationAt(iterCnt - 1).DP_info[rank.getDpGroup()].Rank_ag_time[rank.getDp()] == 0)
             {
-                iterations[iterCnt - 2].DP_info[rank.getDpGroup()].Rank_ag_time[rank.getDp()] = logs.back().timestamp;
+                iterationAt(iterCnt - 1).DP_info[rank.getDpGroup()].Rank_ag_time[rank.getDp()] = logs.back().timestamp;
             }
 
             continue;
@@ -458,19 +631,36 @@ void worker_withSP(const std::string &filePath, int workerID,
             logs.back().process = cur_process.name;
 
             if (logs.size() == cur_process.startIdx)
-                iterations[iterCnt - 1].PP_info[rank.getPpGroup()].nodes[rank.getPp()].emplace_back(rank, logs.back().process, logs.back().iteration, logs.back().timestamp, 0);
+            {
+                if (processCnt == 0 || trainingPattern[processCnt - 1].iteration != cur_process.iteration)
+                    boundaryPoints[workerID].push_back({cur_process.iteration, recordPosition, pendingRecvTime});
+                iterationAt(iterCnt).PP_info[rank.getPpGroup()].nodes[rank.getPp()].emplace_back(rank, logs.back().process, logs.back().iteration, logs.back().timestamp, 0);
+                iterationAt(iterCnt).PP_info[rank.getPpGroup()].nodes[rank.getPp()].back().recvTime = pendingRecvTime;
+                pendingRecvTime = 0;
+            }
             else if (logs.size() == cur_process.endIdx)
             {
-                iterations[iterCnt - 1].PP_info[rank.getPpGroup()].nodes[rank.getPp()].back().endTime = logs.back().timestamp;
-                iterations[iterCnt - 1].PP_info[rank.getPpGroup()].nodes[rank.getPp()].back().calDuration();
+                iterationAt(iterCnt).PP_info[rank.getPpGroup()].nodes[rank.getPp()].back().endTime = logs.back().timestamp;
+                iterationAt(iterCnt).PP_info[rank.getPpGroup()].nodes[rank.getPp()].back().calDuration();
+                fillLayerTiming(iterationAt(iterCnt), rank, cur_process, logs, config);
+                fillAllToAll(iterationAt(iterCnt), rank, cur_process, logs);
                 processCnt++;
             }
+            // SP 模式下 PP 的 send/recv 在 process 内部
+            Node &node = iterationAt(iterCnt).PP_info[rank.getPpGroup()].nodes[rank.getPp()].back();
+            if (logs.back().ncclFunction == "ncclRecv" && node.recvTime == 0)
+                node.recvTime = logs.back().timestamp;
+            else if (logs.back().ncclFunction == "ncclSend")
+                node.sendTime = logs.back().timestamp;
         }
     }
+    // every process read: the rank's last iteration is closed too
+    if (processCnt == trainingPattern.size())
+        boundaryPoints[workerID].push_back({config.iterations + 1, lastLogPosition, 0});
     std::cout << config.outputDicPath << "/" << "ncclLog-rank-" << std::to_string(workerID) << ".txt" << std::endl;
     writeLogsToFile(config.outputDicPath + "/" + "ncclLog-rank-" + std::to_string(workerID) + ".txt", logs);
 
-    if (terminatingNum.fetch_add(1, std::memory_order_acq_rel) + 1 == config.numRanks)
+    if (terminatingNum.fetch_add(1, std::memory_order_acq_rel) + 1 == workerNum)
     {
         sm.Signal();
     }
@@ -478,44 +668,178 @@ void worker_withSP(const std::string &filePath, int workerID,
     return;
 }
 
-void manager(const TrainingConfig &config)
+// Opens a report of the output directory; a resumed run appends to the one
+// the previous runs wrote. True when the file is new and needs its header.
+static bool openReport(std::ofstream &file, const TrainingConfig &config, const std::string &name)
+{
+    std::string path = config.outputDicPath + "/" + name;
+    bool append = !resumePoints.empty();
+    std::error_code ec;
+    bool fresh = !append || std::filesystem::file_size(path, ec) == 0 || ec;
+    file.open(path, append ? std::ios::app : std::ios::out);
+    return file.is_open() && fresh;
+}
+
+void manager(const TrainingConfig &config, Rank *ranks)
 {
     int count = 0;
     int microBatchNum = config.GBS / (config.numRanks / (config.tpSize * config.ppSize));
-    PPTimeTable timetable(config.ppSize, microBatchNum);
+    PPTimeTable timetable(config.ppSize, microBatchNum * config.vpSize, config);
+    // warm start from a previous healthy run of the same model
+    if (!config.baselinePath.empty() && timetable.load(config.baselinePath, modelKey(config)))
+        std::cout << "Loaded baseline " << config.baselinePath << std::endl;
+    // a resumed run continues the baseline as of the last closed iteration
+    bool isCheckpoint = !config.checkpointPath.empty() && deepGroups.empty();
+    if (isCheckpoint && !resumePoints.empty())
+        timetable.load(checkpointBaselinePath(config.checkpointPath), modelKey(config));
     std::chrono::duration<double> total_duration = std::chrono::duration<double>::zero(); // 总时间
     int iteration_count = 0;
+
+    // telemetry rows are joined with the Megatrace records on (commHash, op count)
+    TelemetryIndex telemetry;
+    std::ofstream breakdownFile;
+    if (!config.telemetryPath.empty() && loadTelemetry(config.telemetryPath, telemetry) == 0)
+    {
+        if (openReport(breakdownFile, config, "collective-breakdown.csv"))
+            writeBreakdownHeader(breakdownFile);
+    }
+    std::ofstream skewFile;
+    if (openReport(skewFile, config, "collective-skew.csv"))
+        writeSkewHeader(skewFile);
+    std::ofstream bubbleFile;
+    if (openReport(bubbleFile, config, "pipeline-bubble.csv"))
+        writeBubbleHeader(bubbleFile);
+    std::ofstream layerFile;
+    if (openReport(layerFile, config, "layer-timing.csv"))
+        writeLayerHeader(layerFile);
+    std::ofstream allToAllFile;
+    if (config.epSize > 1 && openReport(allToAllFile, config, "alltoall.csv"))
+        writeAllToAllHeader(allToAllFile);
+    std::ofstream timeFile;
+    if (openReport(timeFile, config, "time-breakdown.csv"))
+        writeTimeHeader(timeFile);
+    std::set<int> whatIfRanks = parseIterationList(config.whatIfRanks);
+    std::ofstream whatIfFile;
+    if (openReport(whatIfFile, config, "what-if.csv"))
+        writeWhatIfHeader(whatIfFile);
+    // a JSON trace cannot be appended to, a resumed run writes its own
+    ChromeTraceWriter chromeTrace(ranks, config.numRanks);
+    std::string tracePath = config.outputDicPath + "/" +
+                            (resumePoints.empty() ? "trace.json" : "trace-" + std::to_string(firstIteration) + ".json");
+    if (config.chromeTrace && !chromeTrace.open(tracePath))
+        std::cerr << "Could not open " << tracePath << std::endl;
+    bool ownsReport = openFindingReport(config.outputDicPath + "/" + "findings.ndjson", ranks, config.numRanks, !resumePoints.empty());
+    DriftMonitor drift(config);
+    if (isCheckpoint && !resumePoints.empty())
+        drift.load(checkpointDriftPath(config.checkpointPath), modelKey(config));
+    std::ofstream driftFile;
+    if (openReport(driftFile, config, "drift.csv"))
+        writeDriftHeader(driftFile);
     sm.Wait();
-    while (count != config.iterations)
+    // an iteration is closed once every rank has started the next one
+    size_t closedBefore = config.iterations + 1;
+    for (int r = 0; r < config.numRanks; r++)
+        closedBefore = std::min(closedBefore, boundaryPoints[r].empty() ? firstIteration : boundaryPoints[r].back().iteration);
+    size_t nextIteration = firstIteration;
+    while ((size_t)count < iterations.size() && count + firstIteration <= config.iterations)
     {
         //sm.Wait();
         Iteration &iteration = iterations[count]; //
+        // the open tail, and a hang in it, is left to the next checkpointed run
+        if (isCheckpoint && (size_t)iteration.iter >= closedBefore)
+            break;
         bool isHang = false;
         auto start_time = std::chrono::high_resolution_clock::now();
 
+        bool isTriage = !deepGroups.empty();
+        if (!isTriage)
+            reportDivergence(findDivergence(iteration.opSequences, iteration.historyLogs, ranks, config.numRanks), iteration.iter);
+        std::vector<Graph> gantts;
+        std::vector<std::string> ganttPaths;
         for (int i = 0; i < iteration.PP_info.size(); i++)
         {
+            if (isTriage && !deepGroups[i])
+                continue;
             Graph graph(iteration.iter, i);
-            isHang |= graph.buildComputationGraph(config.slowThreshold, iteration.PP_info[i], iteration.DP_info, iteration.historyLogs, timetable, config.ppSize * microBatchNum * 2);
+            isHang |= graph.buildComputationGraph(config.slowThreshold, iteration.PP_info[i], iteration.DP_info, iteration.historyLogs, timetable, config.ppSize * microBatchNum * config.vpSize * 2, config.vpSize);
             if (!isHang)
             {
                 graph.calculateCriticalPath();
-                graph.checkSlow(iteration.historyLogs);
+                std::vector<SlowRecord> &&records = graph.checkSlow(iteration.historyLogs);
+                slowRecords.insert(slowRecords.end(), records.begin(), records.end());
+                if (whatIfFile.is_open())
+                    reportWhatIf(whatIfFile, ReplayGraph(graph, timetable), iteration.iter, i, whatIfRanks);
             }
             std::string path = config.outputDicPath + "/" + "graph-iteration" + std::to_string(iteration.iter) + "-ppGroup" + std::to_string(graph.groupID);
 
             graph.graphVisualization(path);
+            if (config.ganttChart)
+            {
+                gantts.push_back(graph);
+                ganttPaths.push_back(path);
+            }
         }
+        writeGantts(gantts, ganttPaths, config.ppSize);
+        if (bubbleFile.is_open())
+        {
+            std::vector<PipelineBubble> bubbles;
+            for (size_t i = 0; i < iteration.PP_info.size(); i++)
+                if (!isTriage || deepGroups[i])
+                    bubbles.push_back(analyzePipeline(iteration.PP_info[i], i, config.ppSize, config.vpSize));
+            reportBubble(bubbleFile, bubbles, iteration.iter);
+        }
+        if (layerFile.is_open())
+            reportLayerTiming(layerFile, iteration, ranks, config, timetable.excluded);
+        // EP groups span PP groups, triage reads only some of them
+        if (allToAllFile.is_open() && !isTriage)
+            reportAllToAll(allToAllFile, iteration, ranks, config);
+        // checkpoint and eval iterations would read as a step, not a drift
+        if (driftFile.is_open() && !isTriage && !isHang && !timetable.isExcluded(iteration.iter))
+            drift.addIteration(driftFile, iteration, ranks, config.numRanks, telemetry);
+        if (timeFile.is_open() && !isTriage)
+            reportTime(timeFile, breakdownTime(iteration.historyLogs, ranks, config.numRanks), iteration.iter, config.ppSize);
+        if (skewFile.is_open() && !isTriage)
+            reportSkew(skewFile, matchCollectives(iteration.historyLogs, ranks, config.numRanks), iteration.iter);
+        if (breakdownFile.is_open() && !isTriage)
+            writeCollectiveBreakdown(breakdownFile, telemetry, iteration.historyLogs, iteration.iter);
+        if (chromeTrace.is_open())
+            chromeTrace.addIteration(iteration, telemetry);
+        nextIteration = iteration.iter + 1;
         count++;
 
         auto end_time = std::chrono::high_resolution_clock::now();
         auto duration = end_time - start_time; // iteration duration
+        reportIterationSummary(iteration.iter, isHang, std::chrono::duration<double>(duration).count());
         total_duration += duration;            // total duration
         iteration_count++;                     
 
         if (iterations.size() <= count || isHang)
             break;
     }
+    if (ownsReport)
+        closeFindingReport();
+    // only durations that were not slow went into the table
+    if (!config.baselinePath.empty() && !timetable.save(config.baselinePath, modelKey(config)))
+        std::cerr << "Could not save baseline " << config.baselinePath << std::endl;
+    if (isCheckpoint)
+    {
+        Checkpoint checkpoint;
+        checkpoint.nextIteration = nextIteration;
+        for (int r = 0; r < config.numRanks; r++)
+        {
+            ResumePoint point = {nextIteration, 0, 0};
+            if (!resumePoints.empty() && resumePoints[r].iteration == nextIteration)
+                point = resumePoints[r];
+            for (const auto &boundary : boundaryPoints[r])
+                if (boundary.iteration == nextIteration)
+                    point = boundary;
+            checkpoint.ranks.push_back(point);
+        }
+        if (!checkpoint.save(config.checkpointPath, config) ||
+            !timetable.save(checkpointBaselinePath(config.checkpointPath), modelKey(config)) ||
+            !drift.save(checkpointDriftPath(config.checkpointPath), modelKey(config)))
+            std::cerr << "Could not save checkpoint " << config.checkpointPath << std::endl;
+    }
 
     if (iteration_count > 0)
     {
@@ -532,10 +856,67 @@ void initParser(Rank *ranks, const TrainingConfig &config)
     std::unordered_map<int, std::thread> workerThread_map;
     iter_finished_state.resize(config.iterations);
 
-    std::vector<std::vector<TrainingProcess>> trainingPatterns = gen_training_pattern(config);
+    const std::string suffix = ".mtc";
+    if (config.inputFilePath.size() > suffix.size() &&
+        config.inputFilePath.compare(config.inputFilePath.size() - suffix.size(), suffix.size(), suffix) == 0)
+    {
+        traceStore = new TraceStore();
+        if (!traceStore->open(config.inputFilePath) || traceStore->numRanks() != config.numRanks)
+        {
+            std::cerr << "Error: " << config.inputFilePath << " is not a store of " << config.numRanks << " ranks" << std::endl;
+            delete traceStore;
+            traceStore = nullptr;
+            return;
+        }
+    }
+    std::vector<std::vector<TrainingProcess>> trainingPatterns = learnTrainingPattern(config, ranks, traceStore);
+    // the report is opened here so the triage findings land in it too
+    bool ownsReport = false;
+    if (config.triageTopK > 0 && config.triageTopK < config.ppGroupSize)
+    {
+        ownsReport = openFindingReport(config.outputDicPath + "/" + "findings.ndjson", ranks, config.numRanks);
+        deepGroups.assign(config.ppGroupSize, false);
+        for (int g : triageGroups(config, ranks, traceStore, trainingPatterns))
+            deepGroups[g] = true;
+    }
+    workerNum = 0;
+    for (int i = 0; i < config.numRanks; i++)
+        workerNum += deepGroups.empty() || deepGroups[ranks[i].getPpGroup()];
+    firstIteration = 1;
+    resumePoints.clear();
+    boundaryPoints.assign(config.numRanks, {});
+    commRanks.clear();
+    Checkpoint checkpoint;
+    if (!config.checkpointPath.empty() && !deepGroups.empty())
+        std::cerr << "checkpointPath is ignored in triage mode" << std::endl;
+    else if (!config.checkpointPath.empty() && checkpoint.load(config.checkpointPath, config))
+    {
+        firstIteration = checkpoint.nextIteration;
+        resumePoints = checkpoint.ranks;
+        for (auto &pattern : trainingPatterns)
+            pattern = resumePattern(pattern, firstIteration);
+        std::cout << "Resuming " << config.checkpointPath << " at iteration " << firstIteration << std::endl;
+    }
+    if (config.liveDeadline > 0 && !deepGroups.empty())
+        std::cerr << "liveDeadline is ignored in triage mode" << std::endl;
+    else if (config.liveDeadline > 0)
+        liveMonitor = new LiveMonitor(config.numRanks, config.liveDeadline);
+    if (config.outputArchive)
+    {
+        ArchiveSink *archive = new ArchiveSink(config.outputDicPath, config.archiveCompress);
+        if (archive->is_open())
+            setOutputSink(archive);
+        else
+        {
+            std::cerr << "Could not open " << config.outputDicPath << "/output.mta, writing loose files" << std::endl;
+            delete archive;
+        }
+    }
 
     for (int i = 0; i < config.numRanks; i++)
     {
+        if (!deepGroups.empty() && !deepGroups[ranks[i].getPpGroup()])
+            continue;
         std::string filePath = config.inputFilePath + "/" + "rank_" + std::to_string(i) + ".log";
         if (!config.isSP)
             workerThread_map[i] = std::move(std::thread(worker_withoutSP, filePath, i, ranks[i], config, trainingPatterns[ranks[i].getPp()]));
@@ -543,7 +924,11 @@ void initParser(Rank *ranks, const TrainingConfig &config)
             workerThread_map[i] = std::move(std::thread(worker_withSP, filePath, i, ranks[i], config, trainingPatterns[ranks[i].getPp()]));
     }
 
-    std::thread managerThread(manager, config);
+    std::thread managerThread(manager, config, ranks);
+    std::thread watchdogThread;
+    if (liveMonitor != nullptr)
+        watchdogThread = std::thread([&]
+                                     { liveMonitor->watch(config, ranks, terminatingNum); });
 
     for (auto &t : workerThread_map)
     {
@@ -553,26 +938,28 @@ void initParser(Rank *ranks, const TrainingConfig &config)
         }
     }
 
+    if (watchdogThread.joinable())
+    {
+        watchdogThread.join();
+    }
     if (managerThread.joinable())
     {
         managerThread.join();
     }
+    delete liveMonitor;
+    liveMonitor = nullptr;
+    delete traceStore;
+    traceStore = nullptr;
+    deepGroups.clear();
+    if (ownsReport)
+        closeFindingReport();
+    getOutputSink().close();
+    setOutputSink(nullptr);
 }
 
 void writeLogsToFile(const std::string &filename, const std::vector<NCCLLog> &logs)
 {
-
-    std::ofstream outFile(filename, std::ios::out);
-
-    if (!outFile.is_open())
-    {
-        outFile.open("." + filename);
-        if (!outFile.is_open())
-        {
-            std::cerr << "Failed to open file: " << filename << std::endl;
-            return;
-        }
-    }
+    std::ostringstream outFile;
     outFile << std::fixed << std::setprecision(9);
     for (const auto &log : logs)
     {
@@ -584,8 +971,9 @@ void writeLogsToFile(const std::string &filename, const std::vector<NCCLLog> &lo
                 << ", Iteration: " << log.iteration
                 << ", Process: " << log.process
                 << ", Latency: " << log.latency
-                << std::endl;
+                << "\n";
     }
 
-    outFile.close();
+    if (!getOutputSink().write(filename, outFile.str()) && !getOutputSink().write("." + filename, outFile.str()))
+        std::cerr << "Failed to open file: " << filename << std::endl;
 }
\ No newline at end of file
@@ -0,0 +1,164 @@
+#include "OpSequence.hpp"
+#include "Findings.hpp"
+#include <iostream>
+#include <algorithm>
+#include <functional>
+#include <map>
+
+OpSequence::OpSequence()
+    : hasReduceScatter(false),
+      lastReduceScatter(0) {}
+
+void OpSequence::add(const NCCLLog &log, size_t logIndex)
+{
+    if (log.ncclFunction == "ncclReduceScatter")
+    {
+        hasReduceScatter = true;
+        lastReduceScatter = logIndex;
+    }
+    // FNV-1a step over the function hash and the element count
+    uint64_t h = prefix.empty() ? 1469598103934665603ULL : prefix.back();
+    h = (h ^ std::hash<std::string>()(log.ncclFunction)) * 1099511628211ULL;
+    h = (h ^ (uint64_t)log.size) * 1099511628211ULL;
+    prefix.push_back(h);
+    index.push_back(logIndex);
+}
+
+std::string sequenceKey(const NCCLLog &log)
+{
+    return log.commHash.empty() ? "stream " + log.streamID : log.commHash;
+}
+
+Divergence::Divergence()
+    : rank(-1),
+      peer(-1),
+      comm(""),
+      position(0),
+      function(""),
+      peerFunction("") {}
+
+static std::string describe(const std::vector<NCCLLog> &logs, const OpSequence &sequence, size_t position)
+{
+    if (position >= sequence.index.size())
+        return "none";
+    const NCCLLog &log = logs[sequence.index[position]];
+    return log.ncclFunction + "(" + std::to_string(log.size) + ")";
+}
+
+static bool isP2P(const std::string &ncclFunction)
+{
+    return ncclFunction == "ncclSend" || ncclFunction == "ncclRecv";
+}
+
+// collectiveKeys of every sequence's first record: the TP stream is the one
+// with the most records without a comm hash (the first to get there on a
+// tie), the DP stream the one with the latest ReduceScatter
+static std::vector<std::pair<std::string, const OpSequence *>>
+sequenceGroups(const std::unordered_map<std::string, OpSequence> &sequences, const std::vector<NCCLLog> &logs, const Rank &rank)
+{
+    const OpSequence *tp = nullptr, *dp = nullptr;
+    for (const auto &it : sequences)
+    {
+        const OpSequence &sequence = it.second;
+        if (sequence.index.empty() || !logs[sequence.index.front()].commHash.empty())
+            continue;
+        size_t size = sequence.index.size();
+        if (tp == nullptr || size > tp->index.size() ||
+            (size == tp->index.size() && sequence.index.back() < tp->index.back()))
+            tp = &sequence;
+        if (sequence.hasReduceScatter && (dp == nullptr || sequence.lastReduceScatter > dp->lastReduceScatter))
+            dp = &sequence;
+    }
+
+    std::vector<std::pair<std::string, const OpSequence *>> groups;
+    for (const auto &it : sequences)
+    {
+        const OpSequence &sequence = it.second;
+        if (sequence.index.empty())
+            continue;
+        const NCCLLog &first = logs[sequence.index.front()];
+        if (isP2P(first.ncclFunction))
+            continue;
+        if (!first.commHash.empty())
+            groups.push_back({first.commHash, &sequence});
+        else if (&sequence == tp)
+            groups.push_back({"tp" + std::to_string(rank.getTpGroup()), &sequence});
+        else if (&sequence == dp)
+            groups.push_back({"dp" + std::to_string(rank.getDpGroup()), &sequence});
+    }
+    return groups;
+}
+
+std::vector<Divergence> findDivergence(const std::vector<std::unordered_map<std::string, OpSequence>> &opSequences,
+                                       const std::vector<std::vector<NCCLLog>> &historyLogs, Rank *ranks, int numRanks)
+{
+    // group key -> (rank, sequence); a stream joins the group of its first
+    // matched record
+    std::map<std::string, std::vector<std::pair<int, const OpSequence *>>> groups;
+    for (int r = 0; r < numRanks && r < (int)opSequences.size(); r++)
+        for (const auto &it : sequenceGroups(opSequences[r], historyLogs[r], ranks[r]))
+            groups[it.first].push_back({r, it.second});
+
+    std::vector<Divergence> divergences;
+    for (const auto &group : groups)
+    {
+        const auto &members = group.second;
+        if (members.size() < 2)
+            continue;
+        size_t common = members.front().second->prefix.size();
+        for (const auto &member : members)
+            common = std::min(common, member.second->prefix.size());
+        if (common == 0)
+            continue;
+
+        std::unordered_map<uint64_t, int> votes;
+        uint64_t majority = 0;
+        for (const auto &member : members)
+            if (++votes[member.second->prefix[common - 1]] > votes[majority])
+                majority = member.second->prefix[common - 1];
+        const std::pair<int, const OpSequence *> *reference = nullptr;
+        for (const auto &member : members)
+            if (member.second->prefix[common - 1] == majority &&
+                (reference == nullptr || member.second->prefix.size() > reference->second->prefix.size()))
+                reference = &member;
+
+        const OpSequence &expected = *reference->second;
+        for (const auto &member : members)
+        {
+            const OpSequence &actual = *member.second;
+            size_t n = std::min(actual.prefix.size(), expected.prefix.size());
+            bool agree = actual.prefix[n - 1] == expected.prefix[n - 1];
+            if (member.first == reference->first || (agree && n == expected.prefix.size()))
+                continue;
+            // prefixes agree up to lo and differ at hi; a rank that stopped
+            // short diverges where its sequence ends
+            size_t lo = 0, hi = n;
+            if (!agree)
+                hi = actual.prefix[0] != expected.prefix[0] ? 0 : n - 1;
+            while (!agree && hi > 0 && lo + 1 < hi)
+            {
+                size_t mid = (lo + hi) / 2;
+                (actual.prefix[mid] == expected.prefix[mid] ? lo : hi) = mid;
+            }
+            Divergence divergence;
+            divergence.rank = member.first;
+            divergence.peer = reference->first;
+            divergence.comm = group.first;
+            divergence.position = hi;
+            divergence.function = describe(historyLogs[member.first], actual, hi);
+            divergence.peerFunction = describe(historyLogs[reference->first], expected, hi);
+            divergences.push_back(divergence);
+        }
+    }
+    return divergences;
+}
+
+void reportDivergence(const std::vector<Divergence> &divergences, int iteration)
+{
+    for (const auto &divergence : divergences)
+    {
+        Finding("divergence").rank(divergence.rank).add("ITERATION", iteration).add("COMM", divergence.comm)
+            .add("POSITION", divergence.position).add("FUNCTION", divergence.function).add("PEER", divergence.peer)
+            .add("EXPECTED", divergence.peerFunction).emit();
+    }
+}
@@ -0,0 +1,187 @@
+#include "OutputSink.hpp"
+#include <iostream>
+#include <memory>
+#include <cstring>
+#ifdef MEGATRACE_ZLIB
+#include <zlib.h>
+#endif
+
+static const char MTA_MAGIC[4] = {'M', 'T', 'A', '1'};
+static const uint32_t MTA_VERSION = 1;
+static const uint8_t CODEC_RAW = 0;
+static const uint8_t CODEC_ZLIB = 1;
+
+OutputSink::~OutputSink() {}
+
+void OutputSink::close() {}
+
+bool FileSink::write(const std::string &path, const std::string &data)
+{
+    std::ofstream file(path, std::ios::out | std::ios::binary);
+    if (!file.is_open())
+        return false;
+    file.write(data.data(), data.size());
+    return file.good();
+}
+
+ArchiveSink::ArchiveSink(const std::string &dir, bool compress)
+    : prefix(dir + "/"),
+      compressSections(compress)
+{
+#ifndef MEGATRACE_ZLIB
+    if (compress)
+        std::cerr << "Built without zlib, archive sections are stored uncompressed" << std::endl;
+    compressSections = false;
+#endif
+    out.open(prefix + "output.mta", std::ios::out | std::ios::binary | std::ios::trunc);
+    uint64_t indexOffset = 0;
+    out.write(MTA_MAGIC, 4);
+    out.write((const char *)&MTA_VERSION, sizeof(MTA_VERSION));
+    out.write((const char *)&indexOffset, sizeof(indexOffset));
+}
+
+ArchiveSink::~ArchiveSink()
+{
+    close();
+}
+
+bool ArchiveSink::is_open() const
+{
+    return out.is_open();
+}
+
+bool ArchiveSink::write(const std::string &path, const std::string &data)
+{
+    Entry entry;
+    entry.name = path.compare(0, prefix.size(), prefix) == 0 ? path.substr(prefix.size()) : path;
+    entry.rawSize = data.size();
+    entry.codec = CODEC_RAW;
+    const std::string *section = &data;
+    std::string packed;
+#ifdef MEGATRACE_ZLIB
+    // compressed outside the lock, so writers on other threads only queue
+    // for the append
+    if (compressSections)
+    {
+        uLongf length = compressBound(data.size());
+        packed.resize(length);
+        if (compress2((Bytef *)&packed[0], &length, (const Bytef *)data.data(), data.size(), Z_DEFAULT_COMPRESSION) == Z_OK &&
+            length < data.size())
+        {
+            packed.resize(length);
+            section = &packed;
+            entry.codec = CODEC_ZLIB;
+        }
+    }
+#endif
+    entry.storedSize = section->size();
+
+    std::lock_guard<std::mutex> lock(mtx);
+    if (!out.is_open())
+        return false;
+    entry.offset = out.tellp();
+    out.write(section->data(), section->size());
+    entries.push_back(entry);
+    return out.good();
+}
+
+void ArchiveSink::close()
+{
+    std::lock_guard<std::mutex> lock(mtx);
+    if (!out.is_open())
+        return;
+    uint64_t indexOffset = out.tellp();
+    uint32_t count = entries.size();
+    out.write((const char *)&count, sizeof(count));
+    for (const auto &entry : entries)
+    {
+        uint16_t length = entry.name.size();
+        out.write((const char *)&length, sizeof(length));
+        out.write(entry.name.data(), length);
+        out.write((const char *)&entry.offset, sizeof(entry.offset));
+        out.write((const char *)&entry.storedSize, sizeof(entry.storedSize));
+        out.write((const char *)&entry.rawSize, sizeof(entry.rawSize));
+        out.write((const char *)&entry.codec, sizeof(entry.codec));
+    }
+    out.seekp(4 + sizeof(MTA_VERSION));
+    out.write((const char *)&indexOffset, sizeof(indexOffset));
+    out.close();
+}
+
+static std::unique_ptr<OutputSink> installedSink;
+
+OutputSink &getOutputSink()
+{
+    static FileSink files;
+    return installedSink ? *installedSink : files;
+}
+
+void setOutputSink(OutputSink *sink)
+{
+    installedSink.reset(sink);
+}
+
+int runCat(const std::string &archivePath, const std::string &entry)
+{
+    std::ifstream in(archivePath, std::ios::in | std::ios::binary);
+    char magic[4];
+    uint32_t version = 0;
+    uint64_t indexOffset = 0;
+    in.read(magic, 4);
+    in.read((char *)&version, sizeof(version));
+    in.read((char *)&indexOffset, sizeof(indexOffset));
+    if (!in || memcmp(magic, MTA_MAGIC, 4) != 0 || version != MTA_VERSION || indexOffset == 0)
+    {
+        std::cerr << "Error: " << archivePath << " is not a complete output archive" << std::endl;
+        return 1;
+    }
+
+    in.seekg(indexOffset);
+    uint32_t count = 0;
+    in.read((char *)&count, sizeof(count));
+    for (uint32_t i = 0; i < count && in; i++)
+    {
+        uint16_t length = 0;
+        std::string name;
+        uint64_t offset, storedSize, rawSize;
+        uint8_t codec;
+        in.read((char *)&length, sizeof(length));
+        name.resize(length);
+        in.read(&name[0], length);
+        in.read((char *)&offset, sizeof(offset));
+        in.read((char *)&storedSize, sizeof(storedSize));
+        in.read((char *)&rawSize, sizeof(rawSize));
+        in.read((char *)&codec, sizeof(codec));
+        if (entry.empty())
+        {
+            std::cout << name << "\t" << rawSize << "\t" << storedSize << std::endl;
+            continue;
+        }
+        if (name != entry)
+            continue;
+
+        std::string section(storedSize, '\0');
+        in.seekg(offset);
+        in.read(&section[0], storedSize);
+        if (codec == CODEC_RAW)
+        {
+            std::cout.write(section.data(), section.size());
+            return 0;
+        }
+#ifdef MEGATRACE_ZLIB
+        std::string data(rawSize, '\0');
+        uLongf dataLength = rawSize;
+        if (codec == CODEC_ZLIB && uncompress((Bytef *)&data[0], &dataLength, (const Bytef *)section.data(), storedSize) == Z_OK)
+        {
+            std::cout.write(data.data(), dataLength);
+            return 0;
+        }
+#endif
+        std::cerr << "Error: cannot decode " << name << " (codec " << (int)codec << ")" << std::endl;
+        return 1;
+    }
+    if (entry.empty())
+        return 0;
+    std::cerr << "Error: no entry " << entry << " in " << archivePath << std::endl;
+    return 1;
+}
@@ -0,0 +1,290 @@
+#include "PatternLearner.hpp"
+#include "AllToAll.hpp"
+#include <iostream>
+#include <fstream>
+#include <unordered_map>
+#include <algorithm>
+
+static const size_t FIRST_RECORDS = 4096;
+static const size_t MAX_RECORDS = 1 << 16;
+
+enum PPOp
+{
+    OP_OTHER,
+    OP_SEND,
+    OP_RECV
+};
+
+// the first limit records of a rank as interned "function size" tokens,
+// and which of them are PP send/recv
+static void readTokens(const std::string &filePath, int rank, TraceStore *store, size_t limit,
+                       std::vector<int> &tokens, std::vector<int> &ops)
+{
+    std::unordered_map<std::string, int> ids;
+    tokens.clear();
+    ops.clear();
+    auto add = [&](const std::string &function, const std::string &key)
+    {
+        tokens.push_back(ids.emplace(key, ids.size()).first->second);
+        ops.push_back(function == "Send" ? OP_SEND : function == "Recv" ? OP_RECV
+                                                                       : OP_OTHER);
+    };
+    if (store != nullptr)
+    {
+        NCCLLog log;
+        for (size_t i = 0; i < limit && store->fetch(rank, i, log) == 0; i++)
+        {
+            std::string function = log.ncclFunction.substr(4); // "nccl"
+            add(function, function + " " + std::to_string(log.size));
+        }
+        return;
+    }
+    // "[ts] [Rank r] Fun AllReduce Data 1 stream 0x..": only the part between
+    // "Fun " and " stream" is looked at
+    std::ifstream file(filePath);
+    std::string line;
+    while (tokens.size() < limit && std::getline(file, line))
+    {
+        size_t fun = line.find("Fun ");
+        size_t stream = line.find(" stream", fun);
+        if (fun == std::string::npos || stream == std::string::npos)
+            break;
+        std::string key = line.substr(fun + 4, stream - fun - 4);
+        add(key.substr(0, key.find(' ')), key);
+    }
+}
+
+// MoE all-to-alls are grouped Send/Recv too: only lone ones mark PP
+static void maskAllToAll(std::vector<int> &ops)
+{
+    for (size_t i = 0; i < ops.size();)
+    {
+        size_t j = i;
+        int sends = 0, recvs = 0;
+        for (; j < ops.size() && ops[j] != OP_OTHER; j++)
+            (ops[j] == OP_SEND ? sends : recvs)++;
+        if (isAllToAll(sends, recvs))
+            std::fill(ops.begin() + i, ops.begin() + j, (int)OP_OTHER);
+        i = std::max(j, i + 1);
+    }
+}
+
+// z[i]: length of the longest common prefix of s and s[i..]
+static std::vector<size_t> zFunction(const std::vector<int> &s)
+{
+    size_t n = s.size();
+    std::vector<size_t> z(n, 0);
+    for (size_t i = 1, l = 0, r = 0; i < n; i++)
+    {
+        if (i < r)
+            z[i] = std::min(r - i, z[i - l]);
+        while (i + z[i] < n && s[z[i]] == s[i + z[i]])
+            z[i]++;
+        if (i + z[i] > r)
+        {
+            l = i;
+            r = i + z[i];
+        }
+    }
+    return z;
+}
+
+// The longest periodic suffix that repeats at least three times: reversed,
+// it is the prefix of length p + z[p]. Multiples of the period cover the
+// same suffix, so the smallest p of the longest cover is taken.
+static bool findPeriod(const std::vector<int> &tokens, size_t &period, size_t &start)
+{
+    std::vector<int> reversed(tokens.rbegin(), tokens.rend());
+    std::vector<size_t> z = zFunction(reversed);
+    size_t best = 0;
+    period = 0;
+    for (size_t p = 1; p * 3 <= reversed.size(); p++)
+    {
+        if (z[p] >= 2 * p && p + z[p] > best)
+        {
+            best = p + z[p];
+            period = p;
+        }
+    }
+    start = tokens.size() - best;
+    return period != 0;
+}
+
+// A PP send/recv of one iteration, expected at
+// x0 + forwards * F + backwards * B + offset
+struct Marker
+{
+    int op;
+    long long forwards;
+    long long backwards;
+    long long offset;
+};
+
+// an F starts with its recv except on the first stage and ends with its
+// send except on the last one; a B the other way round
+static std::vector<Marker> expectedMarkers(const std::string &order, size_t ppIdx, size_t ppSize)
+{
+    std::vector<Marker> markers;
+    long long forwards = 0, backwards = 0;
+    bool isFirst = ppIdx == 0, isLast = ppIdx == ppSize - 1;
+    for (char process : order)
+    {
+        bool isForward = process == 'F';
+        if (isForward ? !isFirst : !isLast)
+            markers.push_back({OP_RECV, forwards, backwards, 0});
+        (isForward ? forwards : backwards)++;
+        if (isForward ? !isLast : !isFirst)
+            markers.push_back({OP_SEND, forwards, backwards, -1});
+    }
+    return markers;
+}
+
+// integer x0, F and B that put every marker exactly on its observed record.
+// When no pair of markers tells F from B, the records the hand-written
+// layout does not know about (MoE all-to-alls run in both directions) are
+// split evenly between them.
+static bool fitMarkers(const std::vector<Marker> &expected, const std::vector<size_t> &observed, const StageLayout &hand,
+                       long long &x0, long long &forward, long long &backward)
+{
+    size_t n = expected.size();
+    std::vector<long long> da(n), db(n), rhs(n);
+    for (size_t i = 0; i < n; i++)
+    {
+        da[i] = expected[i].forwards - expected[0].forwards;
+        db[i] = expected[i].backwards - expected[0].backwards;
+        rhs[i] = (long long)observed[i] - (long long)observed[0] - expected[i].offset + expected[0].offset;
+    }
+    bool solved = false;
+    for (size_t i = 1; i < n && !solved; i++)
+    {
+        for (size_t j = i + 1; j < n && !solved; j++)
+        {
+            long long det = da[i] * db[j] - da[j] * db[i];
+            if (det == 0)
+                continue;
+            long long f = rhs[i] * db[j] - rhs[j] * db[i], b = da[i] * rhs[j] - da[j] * rhs[i];
+            if (f % det != 0 || b % det != 0)
+                return false;
+            forward = f / det;
+            backward = b / det;
+            solved = true;
+        }
+    }
+    for (size_t i = 1; i < n && !solved; i++)
+    {
+        if (da[i] == 0)
+            continue;
+        backward = hand.backward;
+        if (da[i] == db[i] && rhs[i] % da[i] == 0)
+        {
+            long long extra = rhs[i] / da[i] - hand.forward - hand.backward;
+            backward += extra / 2;
+        }
+        if ((rhs[i] - db[i] * backward) % da[i] != 0)
+            return false;
+        forward = (rhs[i] - db[i] * backward) / da[i];
+        solved = true;
+    }
+    if (!solved)
+        return false;
+    x0 = (long long)observed[0] - expected[0].forwards * forward - expected[0].backwards * backward - expected[0].offset;
+    for (size_t i = 0; i < n; i++)
+        if (x0 + expected[i].forwards * forward + expected[i].backwards * backward + expected[i].offset != (long long)observed[i])
+            return false;
+    return true;
+}
+
+static bool learnStage(const std::vector<int> &tokens, const std::vector<int> &ops, const std::string &order,
+                       size_t ppIdx, size_t ppSize, const StageLayout &hand, StageLayout &layout)
+{
+    size_t period, start;
+    if (!findPeriod(tokens, period, start))
+        return false;
+    std::vector<Marker> expected = expectedMarkers(order, ppIdx, ppSize);
+    std::vector<size_t> observed;
+    for (size_t i = start; i < tokens.size() && i < start + 2 * period; i++)
+        if (ops[i] != OP_OTHER)
+            observed.push_back(i);
+    size_t n = expected.size();
+    long long microBatches = std::count(order.begin(), order.end(), 'F');
+    if (n < 2 || microBatches == 0)
+        return false;
+
+    // the periodic part may start inside an iteration: try each marker of
+    // the first period as the first one of an iteration
+    for (size_t k = 0; k + n <= observed.size() && k < n; k++)
+    {
+        std::vector<size_t> window(observed.begin() + k, observed.begin() + k + n);
+        bool matches = true;
+        for (size_t i = 0; i < n && matches; i++)
+            matches = ops[window[i]] == expected[i].op;
+        long long x0, forward, backward;
+        if (!matches || !fitMarkers(expected, window, hand, x0, forward, backward))
+            continue;
+        long long tail = (long long)period - microBatches * (forward + backward);
+        if (forward < 1 || backward < 1 || tail < 0)
+            continue;
+        // the warmup records may end like an iteration does
+        while (x0 >= (long long)(start + period))
+            x0 -= period;
+        while (x0 < (long long)start)
+            x0 += period;
+        layout = {(int)x0, (int)forward, (int)backward, (int)tail};
+        return true;
+    }
+    return false;
+}
+
+std::vector<std::vector<TrainingProcess>> learnTrainingPattern(const TrainingConfig &config, const Rank *ranks, TraceStore *store)
+{
+    std::vector<std::vector<TrainingProcess>> patterns = gen_training_pattern(config);
+    if (!config.learnPattern || config.inputFilePath.empty())
+        return patterns;
+    if (config.vpSize > 1)
+    {
+        std::cout << "Record counts are not learned for interleaved schedules, using the hand-written layout" << std::endl;
+        return patterns;
+    }
+    int layerNumPerRank = config.layers / config.ppSize;
+    for (int pp = 0; pp < config.ppSize; pp++)
+    {
+        int rank = 0;
+        while (rank < config.numRanks && ranks[rank].getPp() != pp)
+            rank++;
+        if (rank == config.numRanks)
+            continue;
+        std::string order;
+        for (const auto &process : patterns[pp])
+            if (process.iteration == 1)
+                order += process.name.find("F") != std::string::npos ? 'F' : 'B';
+
+        StageLayout hand = handLayout(layerNumPerRank, pp, config.ppSize, config.isSP);
+        StageLayout layout;
+        bool learned = false;
+        std::vector<int> tokens, ops;
+        std::string filePath = config.inputFilePath + "/" + "rank_" + std::to_string(rank) + ".log";
+        for (size_t limit = FIRST_RECORDS; limit <= MAX_RECORDS && !learned; limit *= 2)
+        {
+            readTokens(filePath, rank, store, limit, tokens, ops);
+            maskAllToAll(ops);
+            learned = learnStage(tokens, ops, order, pp, config.ppSize, hand, layout);
+            if (tokens.size() < limit)
+                break;
+        }
+        if (!learned)
+        {
+            std::cout << "Stage " << pp << ": no iteration period in the first " << tokens.size() << " records of rank "
+                      << rank << ", using the hand-written layout" << std::endl;
+            continue;
+        }
+        std::cout << "Stage " << pp << ": learned from rank " << rank << ", warmup " << layout.preamble << ", F "
+                  << layout.forward << ", B " << layout.backward << ", tail " << layout.tail << " records";
+        if (layout.preamble != hand.preamble || layout.forward != hand.forward || layout.backward != hand.backward ||
+            layout.tail != hand.tail)
+            std::cout << " (hand-written: " << hand.preamble << ", " << hand.forward << ", " << hand.backward << ", "
+                      << hand.tail << ")";
+        std::cout << std::endl;
+        layoutStage(patterns[pp], config.ppSize, 1, {layout}, config.isSP);
+    }
+    return patterns;
+}
@@ -0,0 +1,138 @@
+#include "PipelineBubble.hpp"
+#include "Findings.hpp"
+#include <iostream>
+#include <algorithm>
+#include <iomanip>
+#include <limits>
+#include <map>
+
+StageBubble::StageBubble(int stage)
+    : stage(stage),
+      microbatches(0),
+      busy(0),
+      idle(0),
+      recvWait(0) {}
+
+PipelineBubble::PipelineBubble(int ppGroup, int ppSize)
+    : ppGroup(ppGroup),
+      span(0),
+      bubbleFraction(0),
+      bottleneck(-1)
+{
+    for (int i = 0; i < ppSize; i++)
+        stages.emplace_back(i);
+}
+
+// A process occupies its stage from its Recv (or first collective) to its
+// Send (or last collective); the part of that spent waiting for the
+// producer's Send is not busy time.
+PipelineBubble analyzePipeline(const PP_Rank_info &ppInfo, int ppGroup, int ppSize, int vpSize)
+{
+    PipelineBubble bubble(ppGroup, ppSize);
+    // per virtual stage: microbatch -> node
+    int virtualStages = ppSize * vpSize;
+    std::vector<std::map<int, const Node *>> forward(virtualStages), backward(virtualStages);
+    double spanStart = std::numeric_limits<double>::max();
+    double spanEnd = 0;
+
+    for (int s = 0; s < ppSize && s < (int)ppInfo.nodes.size(); s++)
+    {
+        for (const auto &node : ppInfo.nodes[s])
+        {
+            int batch;
+            char direction;
+            if (node.endTime <= node.startTime || !parseProcessName(node.processID, batch, direction))
+                continue;
+            int v = virtualStage(node.processID, ppSize, vpSize);
+            if (v < 0 || v >= virtualStages)
+                continue;
+            (direction == 'F' ? forward : backward)[v][batch] = &node;
+            double start = node.recvTime != 0 ? node.recvTime : node.startTime;
+            double end = node.sendTime != 0 ? node.sendTime : node.endTime;
+            bubble.stages[s].busy += end - start;
+            bubble.stages[s].microbatches += direction == 'F';
+            spanStart = std::min(spanStart, start);
+            spanEnd = std::max(spanEnd, end);
+        }
+    }
+    if (spanEnd <= spanStart)
+        return bubble;
+    bubble.span = spanEnd - spanStart;
+
+    // a Recv posted before its producer's Send means the stage sat waiting
+    auto addWait = [&](int stage, const std::map<int, const Node *> &consumer, const std::map<int, const Node *> &producer)
+    {
+        for (const auto &it : consumer)
+        {
+            auto peer = producer.find(it.first);
+            if (peer == producer.end() || it.second->recvTime == 0 || peer->second->sendTime == 0)
+                continue;
+            double wait = std::min(std::max(0.0, peer->second->sendTime - it.second->recvTime),
+                                   it.second->endTime - it.second->recvTime);
+            bubble.stages[stage].recvWait += wait;
+            bubble.stages[stage].busy -= wait;
+        }
+    };
+    // virtual stage v runs on stage v % ppSize, fed by v - 1 in F, v + 1 in B
+    for (int v = 0; v < virtualStages; v++)
+    {
+        if (v > 0)
+            addWait(v % ppSize, forward[v], forward[v - 1]);
+        if (v < virtualStages - 1)
+            addWait(v % ppSize, backward[v], backward[v + 1]);
+    }
+
+    double idleSum = 0;
+    for (auto &stage : bubble.stages)
+    {
+        stage.idle = std::max(0.0, bubble.span - stage.busy);
+        idleSum += stage.idle;
+        if (bubble.bottleneck < 0 || stage.busy > bubble.stages[bubble.bottleneck].busy)
+            bubble.bottleneck = stage.stage;
+    }
+    bubble.bubbleFraction = idleSum / (ppSize * bubble.span);
+    return bubble;
+}
+
+void writeBubbleHeader(std::ofstream &outFile)
+{
+    outFile << "Iteration,PPGroup,Stage,Microbatches,Busy,Idle,RecvWait,Span,BubbleFraction,Bottleneck" << std::endl;
+}
+
+// Writes every group's stages and prints one line per iteration: the mean
+// bubble fraction over PP groups and the stage most often their bottleneck.
+void reportBubble(std::ofstream &outFile, const std::vector<PipelineBubble> &bubbles, int iteration)
+{
+    outFile << std::fixed << std::setprecision(6);
+    std::map<int, int> votes;
+    std::map<int, double> busy, idle, recvWait;
+    double fractionSum = 0;
+    int groups = 0;
+    for (const auto &bubble : bubbles)
+    {
+        if (bubble.span <= 0)
+            continue;
+        for (const auto &stage : bubble.stages)
+        {
+            outFile << iteration << "," << bubble.ppGroup << "," << stage.stage << "," << stage.microbatches << ","
+                    << stage.busy << "," << stage.idle << "," << stage.recvWait << "," << bubble.span << ","
+                    << bubble.bubbleFraction << "," << (stage.stage == bubble.bottleneck) << std::endl;
+            busy[stage.stage] += stage.busy;
+            idle[stage.stage] += stage.idle;
+            recvWait[stage.stage] += stage.recvWait;
+        }
+        votes[bubble.bottleneck]++;
+        fractionSum += bubble.bubbleFraction;
+        groups++;
+    }
+    if (groups == 0)
+        return;
+
+    int bottleneck = std::max_element(votes.begin(), votes.end(), [](const auto &a, const auto &b)
+                                      { return a.second < b.second; })->first;
+    std::vector<double> waits;
+    for (const auto &wait : recvWait)
+        waits.push_back(wait.second / groups);
+    Finding("bubble").add("ITERATION", iteration).add("BUBBLE", fractionSum / groups).add("BOTTLENECK", bottleneck)
+        .add("BUSY", busy[bottleneck] / groups).add("IDLE", idle[bottleneck] / groups).add("RECVWAIT", waits).emit();
+}
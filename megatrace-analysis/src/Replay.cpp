@@ -0,0 +1,179 @@
+#include "Replay.hpp"
+#include "Findings.hpp"
+#include <iostream>
+#include <algorithm>
+#include <iomanip>
+#include <limits>
+#include <map>
+#include <unordered_map>
+
+ReplayGraph::ReplayGraph(const Graph &graph, const PPTimeTable &timetable)
+    : measured(0)
+{
+    // topological order (Kahn); nodes on a cycle are left out
+    std::unordered_map<std::string, int> inDegree;
+    for (const auto &[id, node] : graph.nodes)
+    {
+        inDegree.emplace(id, 0);
+        for (const auto &dep : node.causalDependencies)
+            inDegree[dep]++;
+    }
+    std::vector<std::string> queue;
+    for (const auto &[id, degree] : inDegree)
+        if (degree == 0 && graph.nodes.count(id))
+            queue.push_back(id);
+    std::sort(queue.begin(), queue.end());
+    std::unordered_map<std::string, int> index;
+    for (size_t head = 0; head < queue.size(); head++)
+    {
+        index[queue[head]] = head;
+        for (const auto &dep : graph.nodes.at(queue[head]).causalDependencies)
+            if (--inDegree[dep] == 0 && graph.nodes.count(dep))
+                queue.push_back(dep);
+    }
+    ids = queue;
+
+    size_t n = ids.size();
+    ranks.resize(n);
+    slow.resize(n);
+    duration.resize(n);
+    baseline.resize(n);
+    delay.assign(n, 0);
+    offsets.assign(n + 1, 0);
+    std::vector<double> start(n), end(n), lastEnd(n, 0);
+    double t0 = std::numeric_limits<double>::max();
+    for (size_t i = 0; i < n; i++)
+    {
+        const Node &node = graph.nodes.at(ids[i]);
+        ranks[i] = node.rank.id;
+        slow[i] = node.isSlowNode;
+        // DP nodes keep their RS..AG span in start/end with duration 0
+        duration[i] = node.startTime > 0 && node.endTime > node.startTime ? node.endTime - node.startTime : node.duration;
+        baseline[i] = duration[i];
+        bool process = node.processID.find_first_of("FB") != std::string::npos && node.processID.find("DP") == std::string::npos;
+        if (process && node.ppIndex >= 0 && node.ppIndex < (int)timetable.expectation.size() &&
+            node.batchIndex >= 0 && node.batchIndex < (int)timetable.expectation[node.ppIndex].size() &&
+            timetable.isReady(node.ppIndex, node.batchIndex))
+            baseline[i] = std::min(duration[i], timetable.expectation[node.ppIndex][node.batchIndex]);
+        start[i] = node.startTime;
+        end[i] = node.startTime + duration[i];
+        if (node.startTime > 0)
+            t0 = std::min(t0, node.startTime);
+        for (const auto &dep : node.causalDependencies)
+            if (index.count(dep))
+                offsets[i + 1]++;
+    }
+    for (size_t i = 0; i < n; i++)
+        offsets[i + 1] += offsets[i];
+    targets.resize(offsets[n]);
+    std::vector<bool> hasPred(n, false);
+    for (size_t i = 0; i < n; i++)
+    {
+        int k = offsets[i];
+        for (const auto &dep : graph.nodes.at(ids[i]).causalDependencies)
+        {
+            auto it = index.find(dep);
+            if (it == index.end())
+                continue;
+            targets[k++] = it->second;
+            if (start[i] > 0)
+            {
+                lastEnd[it->second] = std::max(lastEnd[it->second], end[i]);
+                hasPred[it->second] = true;
+            }
+        }
+    }
+    if (t0 == std::numeric_limits<double>::max())
+        t0 = 0;
+    // the end node has no timestamps and simply joins its predecessors
+    for (size_t i = 0; i < n; i++)
+    {
+        if (start[i] <= 0)
+            continue;
+        delay[i] = std::max(0.0, hasPred[i] ? start[i] - lastEnd[i] : start[i] - t0);
+    }
+    measured = makespan(duration);
+}
+
+double ReplayGraph::makespan(const std::vector<double> &durations) const
+{
+    std::vector<double> ready(ids.size(), 0);
+    double span = 0;
+    for (size_t i = 0; i < ids.size(); i++)
+    {
+        double finish = ready[i] + delay[i] + durations[i];
+        span = std::max(span, finish);
+        for (int k = offsets[i]; k < offsets[i + 1]; k++)
+            ready[targets[k]] = std::max(ready[targets[k]], finish);
+    }
+    return span;
+}
+
+double ReplayGraph::whatIf(const std::vector<int> &nodes) const
+{
+    std::vector<double> durations(duration);
+    for (int i : nodes)
+        durations[i] = baseline[i];
+    return makespan(durations);
+}
+
+void writeWhatIfHeader(std::ofstream &outFile)
+{
+    outFile << "Iteration,PPGroup,Target,Rank,Nodes,Makespan,WhatIf,Recoverable" << std::endl;
+}
+
+void reportWhatIf(std::ofstream &outFile, const ReplayGraph &replay, int iteration, int groupID, const std::set<int> &ranks)
+{
+    struct Scenario
+    {
+        std::string target;
+        int rank;
+        std::vector<int> nodes;
+        double makespan;
+    };
+    std::vector<Scenario> scenarios;
+    std::map<int, std::vector<int>> rankNodes;
+    std::set<int> targetRanks(ranks);
+    std::vector<int> allSlow;
+    for (size_t i = 0; i < replay.ids.size(); i++)
+    {
+        rankNodes[replay.ranks[i]].push_back(i);
+        if (!replay.slow[i])
+            continue;
+        scenarios.push_back({replay.ids[i], replay.ranks[i], {(int)i}, 0});
+        targetRanks.insert(replay.ranks[i]);
+        allSlow.push_back(i);
+    }
+    // a rank's whole stage at baseline speed
+    for (int rank : targetRanks)
+        if (rankNodes.count(rank))
+            scenarios.push_back({"rank", rank, rankNodes[rank], 0});
+    if (allSlow.size() > 1)
+        scenarios.push_back({"all-slow", -1, allSlow, 0});
+    if (scenarios.empty())
+        return;
+
+    for (auto &scenario : scenarios)
+        scenario.makespan = replay.whatIf(scenario.nodes);
+    std::sort(scenarios.begin(), scenarios.end(), [](const Scenario &a, const Scenario &b)
+              { return a.makespan < b.makespan; });
+
+    outFile << std::fixed << std::setprecision(6);
+    for (const auto &scenario : scenarios)
+    {
+        outFile << iteration << "," << groupID << "," << scenario.target << "," << scenario.rank << ","
+                << scenario.nodes.size() << "," << replay.measured << "," << scenario.makespan << ","
+                << replay.measured - scenario.makespan << std::endl;
+        if (ranks.count(scenario.rank) && scenario.target == "rank")
+            Finding("what-if").rank(scenario.rank).add("ITERATION", iteration).add("PPGROUP", groupID)
+                .add("RECOVERABLE", replay.measured - scenario.makespan).emit();
+    }
+    for (const auto &scenario : scenarios)
+    {
+        if (scenario.target == "all-slow" || replay.measured - scenario.makespan <= 0)
+            continue;
+        Finding("what-if").rank(scenario.rank).add("ITERATION", iteration).add("PPGROUP", groupID)
+            .add("TARGET", scenario.target).add("RECOVERABLE", replay.measured - scenario.makespan).emit();
+        break;
+    }
+}
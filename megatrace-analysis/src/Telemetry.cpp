@@ -0,0 +1,349 @@
+#include "Telemetry.hpp"
+#include <iostream>
+#include <sstream>
+#include <filesystem>
+#include <algorithm>
+#include <map>
+#include <set>
+#include <tuple>
+#include <iomanip>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <cstring>
+
+// Megatrace timestamps are shifted by this many seconds in parseLog
+static const double TIMESTAMP_OFFSET = 1735689600.0;
+
+TelemetryRecord::TelemetryRecord()
+    : host(""),
+      nic(""),
+      port(-1),
+      devIndex(-1),
+      fromRank(-1),
+      toRank(-1),
+      func(-1),
+      funcTimes(0),
+      srcIP(""),
+      dstIP(""),
+      bandwidth(0),
+      startTime(0),
+      endTime(0),
+      bytes(0),
+      commHash(""),
+      groupHash("") {}
+
+std::string collectiveKey(const std::string &commHash, unsigned long long opCount)
+{
+    return commHash + ":" + std::to_string(opCount);
+}
+
+void TelemetryIndex::add(const TelemetryRecord &record)
+{
+    byCollective[collectiveKey(record.commHash, record.funcTimes)].push_back(records.size());
+    records.push_back(record);
+}
+
+const std::vector<size_t> *TelemetryIndex::find(const std::string &commHash, unsigned long long opCount) const
+{
+    auto it = byCollective.find(collectiveKey(commHash, opCount));
+    if (it == byCollective.end())
+        return nullptr;
+    return &it->second;
+}
+
+// Splits a CSV line in place; fields point into line and are NUL-terminated.
+static void splitCSV(std::string &line, std::vector<char *> &fields)
+{
+    fields.clear();
+    char *field = &line[0];
+    fields.push_back(field);
+    for (char *c = field; *c; c++)
+    {
+        if (*c == ',')
+        {
+            *c = '\0';
+            fields.push_back(c + 1);
+        }
+    }
+}
+
+static double nsToTimestamp(const char *ns)
+{
+    unsigned long long value = strtoull(ns, nullptr, 10);
+    return (double)(value / 1000000000ULL) - TIMESTAMP_OFFSET + (double)(value % 1000000000ULL) / 1e9;
+}
+
+// <host>_<nic>_Port<d>_A.log; the NIC name itself may contain '_' (mlx5_0),
+// host names are assumed not to.
+static bool parseTelemetryFileName(const std::string &fileName, std::string &host, std::string &nic, int &port)
+{
+    size_t portPos = fileName.rfind("_Port");
+    size_t hostPos = fileName.find('_');
+    if (portPos == std::string::npos || hostPos == std::string::npos || hostPos >= portPos)
+        return false;
+    if (fileName.size() < 6 || (fileName.compare(fileName.size() - 6, 6, "_A.log") != 0 &&
+                                fileName.compare(fileName.size() - 6, 6, "_B.log") != 0))
+        return false;
+    host = fileName.substr(0, hostPos);
+    nic = fileName.substr(hostPos + 1, portPos - hostPos - 1);
+    try
+    {
+        port = std::stoi(fileName.substr(portPos + 5));
+    }
+    catch (...)
+    {
+        return false;
+    }
+    return true;
+}
+
+int parseTelemetryFile(const std::string &filePath, std::vector<TelemetryRecord> &records)
+{
+    std::string host, nic;
+    int port = -1;
+    std::string fileName = std::filesystem::path(filePath).filename().string();
+    if (!parseTelemetryFileName(fileName, host, nic, port))
+        return -1;
+
+    std::ifstream file(filePath);
+    if (!file.is_open())
+    {
+        std::cerr << "Error: Unable to open file " << filePath << std::endl;
+        return -1;
+    }
+
+    // columns are looked up by name so older files without the trailing
+    // StartTimestamp/CommHash columns are skipped instead of misread
+    enum { GROUP, FROM_RANK, TO_RANK, DEV_INDEX, FUNC, FUNC_TIMES, SRC_IP, DST_IP, BANDWIDTH,
+           TIMESTAMP, BYTES, START_TIMESTAMP, COMM_HASH, COLUMN_NUM };
+    static const char *columnNames[COLUMN_NUM] = {"Group", "FromRank", "ToRank", "DevIndex", "Func",
+                                                  "FuncTimes", "SrcIP", "DstIP", "Bandwidth", "Timestamp",
+                                                  "Bytes", "StartTimestamp", "CommHash"};
+    size_t column[COLUMN_NUM];
+    bool hasHeader = false;
+    size_t fieldNum = 0;
+    std::vector<char *> fields;
+    std::string line;
+    while (getline(file, line))
+    {
+        if (line.empty())
+            continue;
+        splitCSV(line, fields);
+        if (strcmp(fields[0], "Time") == 0)
+        {
+            hasHeader = true;
+            fieldNum = fields.size();
+            for (int i = 0; i < COLUMN_NUM; i++)
+            {
+                auto it = std::find_if(fields.begin(), fields.end(), [&](const char *name)
+                                       { return strcmp(name, columnNames[i]) == 0; });
+                if (it == fields.end())
+                    hasHeader = false;
+                else
+                    column[i] = it - fields.begin();
+            }
+            continue;
+        }
+        if (!hasHeader || fields.size() < fieldNum)
+            continue;
+
+        TelemetryRecord record;
+        record.host = host;
+        record.nic = nic;
+        record.port = port;
+        record.groupHash = fields[column[GROUP]];
+        record.devIndex = atoi(fields[column[DEV_INDEX]]);
+        record.fromRank = atoi(fields[column[FROM_RANK]]);
+        record.toRank = atoi(fields[column[TO_RANK]]);
+        record.func = atoi(fields[column[FUNC]]);
+        record.funcTimes = strtoull(fields[column[FUNC_TIMES]], nullptr, 10);
+        record.srcIP = fields[column[SRC_IP]];
+        record.dstIP = fields[column[DST_IP]];
+        record.bandwidth = atoi(fields[column[BANDWIDTH]]);
+        record.startTime = nsToTimestamp(fields[column[START_TIMESTAMP]]);
+        record.endTime = nsToTimestamp(fields[column[TIMESTAMP]]);
+        record.bytes = atoll(fields[column[BYTES]]);
+        record.commHash = fields[column[COMM_HASH]];
+        records.push_back(record);
+    }
+    file.close();
+    return 0;
+}
+
+std::vector<std::string> listTelemetryFiles(const std::string &dirPath)
+{
+    std::vector<std::string> files;
+    std::error_code ec;
+    std::filesystem::directory_iterator dir(dirPath, ec);
+    if (ec)
+    {
+        std::cerr << "Error: Unable to open telemetry directory " << dirPath << std::endl;
+        return files;
+    }
+    // sizes are taken once: a file rotated away while listing sorts last
+    // instead of throwing out of the comparator
+    std::vector<std::pair<uintmax_t, std::string>> sized;
+    for (const auto &entry : dir)
+    {
+        std::string host, nic;
+        int port;
+        if (entry.is_regular_file(ec) && parseTelemetryFileName(entry.path().filename().string(), host, nic, port))
+        {
+            uintmax_t size = std::filesystem::file_size(entry.path(), ec);
+            sized.emplace_back(ec ? 0 : size, entry.path().string());
+        }
+    }
+    // largest first so one big file does not end up last on a single thread
+    std::sort(sized.begin(), sized.end(), [](const std::pair<uintmax_t, std::string> &a, const std::pair<uintmax_t, std::string> &b)
+              { return a.first > b.first; });
+    for (auto &file : sized)
+        files.push_back(std::move(file.second));
+    return files;
+}
+
+void parseTelemetryFiles(const std::vector<std::string> &files,
+                         const std::function<void(int, std::vector<TelemetryRecord> &)> &consume)
+{
+    int threadNum = std::max(1, std::min((int)std::thread::hardware_concurrency(), (int)files.size()));
+    std::atomic<size_t> next(0);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < threadNum; t++)
+    {
+        threads.emplace_back([&, t]()
+                             {
+            std::vector<TelemetryRecord> records;
+            for (size_t i = next++; i < files.size(); i = next++)
+            {
+                records.clear();
+                if (parseTelemetryFile(files[i], records) == 0)
+                    consume(t, records);
+            } });
+    }
+    for (auto &thread : threads)
+        thread.join();
+}
+
+int loadTelemetry(const std::string &dirPath, TelemetryIndex &index)
+{
+    std::vector<std::string> files = listTelemetryFiles(dirPath);
+    if (files.empty())
+        return -1;
+    std::mutex indexMutex;
+    parseTelemetryFiles(files, [&](int, std::vector<TelemetryRecord> &records)
+                        {
+        std::lock_guard<std::mutex> lock(indexMutex);
+        for (const auto &record : records)
+            index.add(record); });
+    std::cout << "Telemetry: " << index.records.size() << " records, "
+              << index.byCollective.size() << " collectives" << std::endl;
+    return 0;
+}
+
+std::unordered_map<std::string, std::vector<int>> commMembers(const std::vector<std::vector<NCCLLog>> &historyLogs)
+{
+    std::unordered_map<std::string, std::set<int>> members;
+    for (const auto &logs : historyLogs)
+        for (const auto &log : logs)
+            if (!log.commHash.empty())
+                members[log.commHash].insert(log.rankID);
+    std::unordered_map<std::string, std::vector<int>> sortedMembers;
+    for (const auto &member : members)
+        sortedMembers[member.first].assign(member.second.begin(), member.second.end());
+    return sortedMembers;
+}
+
+void writeBreakdownHeader(std::ofstream &outFile)
+{
+    outFile << "Iteration,CommHash,Op,Function,FirstCall,CallSkew,FromRank,ToRank,Host,NIC,Port,DevIndex,"
+            << "Start,End,Bytes,Gbps" << std::endl;
+}
+
+// Joins every collective of one iteration with its telemetry rows and writes
+// one line per (peer pair, NIC, QP index) transfer interval. Start/End are
+// relative to the first rank entering the collective, so the rows of one
+// collective read as its duration broken down by peer and NIC.
+void writeCollectiveBreakdown(std::ofstream &outFile, const TelemetryIndex &index,
+                              const std::vector<std::vector<NCCLLog>> &historyLogs, int iteration)
+{
+    std::unordered_map<std::string, std::vector<int>> members = commMembers(historyLogs);
+
+    struct Call
+    {
+        std::string commHash;
+        unsigned long long opCount;
+        std::string function;
+        double firstCall;
+        double lastCall;
+    };
+    std::unordered_map<std::string, Call> calls;
+    std::vector<std::string> order;
+    for (const auto &logs : historyLogs)
+    {
+        for (const auto &log : logs)
+        {
+            if (log.commHash.empty())
+                continue;
+            std::string key = collectiveKey(log.commHash, log.opCount);
+            auto it = calls.find(key);
+            if (it == calls.end())
+            {
+                calls[key] = {log.commHash, log.opCount, log.ncclFunction, log.timestamp, log.timestamp};
+                order.push_back(key);
+            }
+            else
+            {
+                it->second.firstCall = std::min(it->second.firstCall, log.timestamp);
+                it->second.lastCall = std::max(it->second.lastCall, log.timestamp);
+            }
+        }
+    }
+    std::sort(order.begin(), order.end(), [&](const std::string &a, const std::string &b)
+              { return calls[a].firstCall < calls[b].firstCall; });
+
+    outFile << std::fixed << std::setprecision(6);
+    for (const auto &key : order)
+    {
+        const Call &call = calls[key];
+        const std::vector<size_t> *rows = index.find(call.commHash, call.opCount);
+        if (rows == nullptr)
+            continue;
+        const std::vector<int> &ranks = members[call.commHash];
+        auto globalRank = [&](int commRank)
+        { return (commRank >= 0 && commRank < (int)ranks.size()) ? ranks[commRank] : -1; };
+
+        // merge the per-request rows of one transfer
+        std::map<std::tuple<int, int, std::string, std::string, int, int>, std::tuple<double, double, long long>> transfers;
+        for (size_t row : *rows)
+        {
+            const TelemetryRecord &record = index.records[row];
+            auto key = std::make_tuple(globalRank(record.fromRank), globalRank(record.toRank),
+                                       record.host, record.nic, record.port, record.devIndex);
+            auto it = transfers.find(key);
+            if (it == transfers.end())
+            {
+                transfers[key] = std::make_tuple(record.startTime, record.endTime, record.bytes);
+            }
+            else
+            {
+                std::get<0>(it->second) = std::min(std::get<0>(it->second), record.startTime);
+                std::get<1>(it->second) = std::max(std::get<1>(it->second), record.endTime);
+                std::get<2>(it->second) += record.bytes;
+            }
+        }
+        for (const auto &transfer : transfers)
+        {
+            double start = std::get<0>(transfer.second);
+            double end = std::get<1>(transfer.second);
+            long long bytes = std::get<2>(transfer.second);
+            double gbps = end > start ? bytes * 8 / (end - start) / 1e9 : 0;
+            outFile << iteration << "," << call.commHash << "," << call.opCount << "," << call.function << ","
+                    << call.firstCall << "," << call.lastCall - call.firstCall << ","
+                    << std::get<0>(transfer.first) << "," << std::get<1>(transfer.first) << ","
+                    << std::get<2>(transfer.first) << "," << std::get<3>(transfer.first) << ","
+                    << std::get<4>(transfer.first) << "," << std::get<5>(transfer.first) << ","
+                    << start - call.firstCall << "," << end - call.firstCall << ","
+                    << bytes << "," << gbps << std::endl;
+        }
+    }
+}
@@ -0,0 +1,129 @@
+#include "TimeBreakdown.hpp"
+#include "Findings.hpp"
+#include "CollectiveMatcher.hpp"
+#include <iostream>
+#include <algorithm>
+#include <iomanip>
+#include <map>
+
+RankBreakdown::RankBreakdown()
+    : stage(-1),
+      compute(0),
+      commWait(0),
+      hostStall(0),
+      intervals(0) {}
+
+std::vector<RankBreakdown> breakdownTime(const std::vector<std::vector<NCCLLog>> &historyLogs, Rank *ranks, int numRanks)
+{
+    std::vector<std::vector<double>> last = lastArrivals(historyLogs, ranks, numRanks);
+    std::vector<RankBreakdown> breakdowns(numRanks);
+    // residual after communication wait of every interval
+    std::vector<std::vector<double>> residual(numRanks);
+
+    for (int r = 0; r < numRanks && r < (int)historyLogs.size(); r++)
+    {
+        const std::vector<NCCLLog> &logs = historyLogs[r];
+        breakdowns[r].stage = ranks[r].getPp();
+        if (logs.size() < 2)
+            continue;
+        residual[r].resize(logs.size() - 1);
+        for (size_t i = 0; i + 1 < logs.size(); i++)
+        {
+            double gap = std::max(0.0, logs[i + 1].timestamp - logs[i].timestamp);
+            double wait = 0;
+            // Megatron waits on the P2P request before it computes on the tensor
+            if (logs[i].ncclFunction == "ncclRecv")
+                wait = gap;
+            else if (last[r][i] != 0)
+                wait = std::min(gap, std::max(0.0, last[r][i] - logs[i].timestamp));
+            breakdowns[r].commWait += wait;
+            breakdowns[r].intervals++;
+            residual[r][i] = gap - wait;
+        }
+    }
+
+    // ranks of a stage run the same schedule, so their i-th intervals are the
+    // same work; only ranks with the stage's most common record count compare
+    std::map<int, std::map<size_t, std::vector<int>>> stageRanks;
+    for (int r = 0; r < numRanks; r++)
+        if (!residual[r].empty())
+            stageRanks[breakdowns[r].stage][residual[r].size()].push_back(r);
+
+    for (const auto &stage : stageRanks)
+    {
+        auto modal = stage.second.begin();
+        for (auto group = stage.second.begin(); group != stage.second.end(); ++group)
+        {
+            if (group->second.size() > modal->second.size())
+                modal = group;
+        }
+        // the others have no peer doing the same work: all of it is compute
+        for (const auto &group : stage.second)
+        {
+            if (&group == &*modal)
+                continue;
+            for (int r : group.second)
+                for (double time : residual[r])
+                    breakdowns[r].compute += time;
+        }
+
+        const std::vector<int> &members = modal->second;
+        std::vector<double> peers(members.size());
+        for (size_t i = 0; i < modal->first; i++)
+        {
+            for (size_t m = 0; m < members.size(); m++)
+                peers[m] = residual[members[m]][i];
+            std::nth_element(peers.begin(), peers.begin() + peers.size() / 2, peers.end());
+            double median = peers[peers.size() / 2];
+            for (int r : members)
+            {
+                const std::vector<NCCLLog> &logs = historyLogs[r];
+                double time = residual[r][i];
+                // a stream switch is issued by the host thread; being late
+                // there while the peers were not is the host's doing
+                double stall = logs[i].streamID != logs[i + 1].streamID ? std::max(0.0, time - median) : 0;
+                breakdowns[r].compute += time - stall;
+                breakdowns[r].hostStall += stall;
+            }
+        }
+    }
+    return breakdowns;
+}
+
+void writeTimeHeader(std::ofstream &outFile)
+{
+    outFile << "Iteration,Rank,Stage,Intervals,Compute,CommWait,HostStall" << std::endl;
+}
+
+// Writes every rank's row and prints the per-stage means of one iteration.
+void reportTime(std::ofstream &outFile, const std::vector<RankBreakdown> &breakdowns, int iteration, int ppSize)
+{
+    std::vector<double> compute(ppSize, 0), commWait(ppSize, 0), hostStall(ppSize, 0);
+    std::vector<int> count(ppSize, 0);
+    outFile << std::fixed << std::setprecision(6);
+    for (size_t i = 0; i < breakdowns.size(); i++)
+    {
+        const RankBreakdown &breakdown = breakdowns[i];
+        if (breakdown.intervals == 0 || breakdown.stage < 0 || breakdown.stage >= ppSize)
+            continue;
+        outFile << iteration << "," << i << "," << breakdown.stage << "," << breakdown.intervals << ","
+                << breakdown.compute << "," << breakdown.commWait << "," << breakdown.hostStall << std::endl;
+        compute[breakdown.stage] += breakdown.compute;
+        commWait[breakdown.stage] += breakdown.commWait;
+        hostStall[breakdown.stage] += breakdown.hostStall;
+        count[breakdown.stage]++;
+    }
+    if (std::count(count.begin(), count.end(), 0) == ppSize)
+        return;
+
+    // per-stage means
+    auto join = [&](const std::vector<double> &values)
+    {
+        std::vector<double> means(ppSize);
+        for (int s = 0; s < ppSize; s++)
+            means[s] = count[s] ? values[s] / count[s] : 0;
+        return means;
+    };
+    Finding("breakdown").add("ITERATION", iteration).add("COMPUTE", join(compute)).add("COMMWAIT", join(commWait))
+        .add("HOSTSTALL", join(hostStall)).emit();
+}
@@ -0,0 +1,276 @@
+#include "TraceStore.hpp"
+#include "Rank.hpp"
+#include "PatternLearner.hpp"
+#include <iostream>
+#include <cstring>
+#include <unordered_map>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+static const char MTC_MAGIC[4] = {'M', 'T', 'C', '1'};
+static const uint32_t MTC_VERSION = 1;
+// parseLog's epoch, applied to the stored absolute nanoseconds
+static const int64_t EPOCH_SECONDS = 1735689600;
+
+// count elements of width bytes at offset lie inside a mapping of length
+// bytes, without overflowing on corrupt offsets
+static bool fits(uint64_t offset, uint64_t count, uint64_t width, uint64_t length)
+{
+    return offset <= length && count <= (length - offset) / width;
+}
+
+TraceStore::TraceStore()
+    : base(nullptr),
+      length(0),
+      header(nullptr),
+      ranks(nullptr) {}
+
+TraceStore::~TraceStore()
+{
+    if (base != nullptr)
+        munmap((void *)base, length);
+}
+
+bool TraceStore::open(const std::string &path)
+{
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(MtcHeader))
+    {
+        close(fd);
+        return false;
+    }
+    length = st.st_size;
+    void *mapping = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED)
+        return false;
+    base = (const char *)mapping;
+    header = (const MtcHeader *)base;
+    if (memcmp(header->magic, MTC_MAGIC, 4) != 0 || header->version != MTC_VERSION ||
+        !fits(header->rankOffset, header->numRanks, sizeof(MtcRank), length) ||
+        !fits(header->stringOffset, (uint64_t)header->numStrings + 1, sizeof(uint64_t), length))
+        return false;
+    ranks = (const MtcRank *)(base + header->rankOffset);
+    // a truncated or corrupt store is rejected here rather than read past
+    // its end while decoding
+    for (uint32_t r = 0; r < header->numRanks; r++)
+    {
+        const MtcRank &info = ranks[r];
+        if (!fits(info.timeOffset, info.records, sizeof(int64_t), length) ||
+            !fits(info.functionOffset, info.records, sizeof(uint32_t), length) ||
+            !fits(info.streamOffset, info.records, sizeof(uint32_t), length) ||
+            !fits(info.commOffset, info.records, sizeof(uint32_t), length) ||
+            !fits(info.opOffset, info.records, sizeof(uint64_t), length) ||
+            !fits(info.sizeOffset, info.records, sizeof(int64_t), length) ||
+            !fits(info.iterationOffset, info.iterations, sizeof(MtcIterationIndex), length))
+            return false;
+    }
+
+    const uint64_t *offsets = (const uint64_t *)(base + header->stringOffset);
+    const char *chars = (const char *)(offsets + header->numStrings + 1);
+    uint64_t charsOffset = header->stringOffset + ((uint64_t)header->numStrings + 1) * sizeof(uint64_t);
+    for (uint32_t i = 0; i < header->numStrings; i++)
+    {
+        if (offsets[i] > offsets[i + 1] || !fits(charsOffset, offsets[i + 1], 1, length))
+            return false;
+        strings.emplace_back(chars + offsets[i], offsets[i + 1] - offsets[i]);
+    }
+
+    cursorIndex.assign(header->numRanks, 0);
+    cursorNs.resize(header->numRanks);
+    for (uint32_t r = 0; r < header->numRanks; r++)
+        cursorNs[r] = ranks[r].baseNs;
+    return true;
+}
+
+int TraceStore::numRanks() const
+{
+    return header == nullptr ? 0 : header->numRanks;
+}
+
+size_t TraceStore::records(int rank) const
+{
+    return rank < numRanks() ? ranks[rank].records : 0;
+}
+
+size_t TraceStore::iterationStart(int rank, int iteration) const
+{
+    if (rank >= numRanks() || iteration < 1 || (uint64_t)iteration > ranks[rank].iterations)
+        return records(rank);
+    const MtcIterationIndex *index = (const MtcIterationIndex *)(base + ranks[rank].iterationOffset);
+    return index[iteration - 1].record;
+}
+
+// sequential reads add one delta; anything else restarts from the nearest
+// iteration anchor at or before index
+int64_t TraceStore::timeAt(int rank, size_t index)
+{
+    const MtcRank &info = ranks[rank];
+    const int64_t *deltas = (const int64_t *)(base + info.timeOffset);
+    if (index != cursorIndex[rank] + 1 && index != cursorIndex[rank])
+    {
+        cursorIndex[rank] = 0;
+        cursorNs[rank] = info.baseNs;
+        const MtcIterationIndex *anchors = (const MtcIterationIndex *)(base + info.iterationOffset);
+        for (uint64_t i = 0; i < info.iterations && anchors[i].record <= index; i++)
+        {
+            if (anchors[i].record < info.records)
+            {
+                cursorIndex[rank] = anchors[i].record;
+                cursorNs[rank] = anchors[i].timeNs;
+            }
+        }
+        while (cursorIndex[rank] < index)
+            cursorNs[rank] += deltas[++cursorIndex[rank]];
+    }
+    else if (index == cursorIndex[rank] + 1)
+        cursorNs[rank] += deltas[++cursorIndex[rank]];
+    return cursorNs[rank];
+}
+
+int TraceStore::fetch(int rank, size_t index, NCCLLog &log)
+{
+    if (rank >= numRanks() || index >= ranks[rank].records)
+        return -1;
+    const MtcRank &info = ranks[rank];
+    int64_t ns = timeAt(rank, index);
+    log = NCCLLog();
+    log.timestamp = (double)(ns / 1000000000 - EPOCH_SECONDS) + (double)(ns % 1000000000) / 1e9;
+    log.rankID = rank;
+    log.ncclFunction = strings[((const uint32_t *)(base + info.functionOffset))[index]];
+    log.streamID = strings[((const uint32_t *)(base + info.streamOffset))[index]];
+    log.commHash = strings[((const uint32_t *)(base + info.commOffset))[index]];
+    log.opCount = ((const uint64_t *)(base + info.opOffset))[index];
+    log.size = ((const int64_t *)(base + info.sizeOffset))[index];
+    return 0;
+}
+
+// "1746686438.086068203" -> ns, exact unlike the double parseLog keeps
+static int64_t parseNanoseconds(const std::string &line)
+{
+    size_t end = line.find(']');
+    std::string stamp = line.substr(1, end - 1);
+    size_t dot = stamp.find('.');
+    std::string fraction = dot == std::string::npos ? "" : stamp.substr(dot + 1);
+    fraction.resize(9, '0');
+    return std::stoll(stamp.substr(0, dot)) * 1000000000 + std::stoll(fraction);
+}
+
+template <typename T>
+static uint64_t writeColumn(std::ofstream &out, const std::vector<T> &column)
+{
+    uint64_t offset = out.tellp();
+    out.write((const char *)column.data(), column.size() * sizeof(T));
+    // keep the next column 8-byte aligned
+    static const char padding[8] = {0};
+    out.write(padding, (8 - out.tellp() % 8) % 8);
+    return offset;
+}
+
+int runConvert(const std::string &logDir, const std::string &storePath, TrainingConfig &config)
+{
+    Rank *rankInfo = initRanks(config);
+    std::vector<std::vector<TrainingProcess>> patterns = learnTrainingPattern(config, rankInfo, nullptr);
+
+    std::ofstream out(storePath, std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!out.is_open())
+    {
+        std::cerr << "Error: Could not open " << storePath << std::endl;
+        releaseRanks(rankInfo, config);
+        return 1;
+    }
+    MtcHeader header;
+    memset(&header, 0, sizeof(header));
+    out.write((const char *)&header, sizeof(header));
+
+    std::vector<std::string> strings = {""};
+    std::unordered_map<std::string, uint32_t> stringIds = {{"", 0}};
+    auto intern = [&](const std::string &value)
+    {
+        auto it = stringIds.find(value);
+        if (it != stringIds.end())
+            return it->second;
+        stringIds[value] = strings.size();
+        strings.push_back(value);
+        return (uint32_t)strings.size() - 1;
+    };
+
+    std::vector<MtcRank> directory(config.numRanks);
+    size_t total = 0;
+    for (int r = 0; r < config.numRanks; r++)
+    {
+        std::vector<std::string> lines = readLogsFromFile(logDir + "/" + "rank_" + std::to_string(r) + ".log");
+        std::vector<NCCLLog> logs;
+        logs.reserve(lines.size());
+        if (parseLogs(lines, logs) != 0)
+        {
+            std::cerr << "Error: rank_" << r << ".log is not a Megatrace log" << std::endl;
+            releaseRanks(rankInfo, config);
+            return 1;
+        }
+
+        std::vector<int64_t> deltas(logs.size()), sizes(logs.size()), absolute(logs.size());
+        std::vector<uint32_t> functions(logs.size()), streams(logs.size()), comms(logs.size());
+        std::vector<uint64_t> ops(logs.size());
+        for (size_t i = 0; i < logs.size(); i++)
+        {
+            absolute[i] = parseNanoseconds(lines[i]);
+            deltas[i] = i == 0 ? 0 : absolute[i] - absolute[i - 1];
+            functions[i] = intern(logs[i].ncclFunction);
+            streams[i] = intern(logs[i].streamID);
+            comms[i] = intern(logs[i].commHash);
+            ops[i] = logs[i].opCount;
+            sizes[i] = logs[i].size;
+        }
+
+        // the first F/B process of every iteration this rank's stage runs
+        std::vector<MtcIterationIndex> index;
+        for (const auto &process : patterns[rankInfo[r].getPp()])
+        {
+            if (process.iteration != index.size() + 1)
+                continue;
+            uint64_t record = std::min<uint64_t>(process.startIdx - 1, logs.size());
+            index.push_back({record, record < logs.size() ? absolute[record] : 0});
+        }
+
+        MtcRank &info = directory[r];
+        info.records = logs.size();
+        info.baseNs = logs.empty() ? 0 : absolute[0];
+        info.timeOffset = writeColumn(out, deltas);
+        info.functionOffset = writeColumn(out, functions);
+        info.streamOffset = writeColumn(out, streams);
+        info.commOffset = writeColumn(out, comms);
+        info.opOffset = writeColumn(out, ops);
+        info.sizeOffset = writeColumn(out, sizes);
+        info.iterations = index.size();
+        info.iterationOffset = writeColumn(out, index);
+        total += logs.size();
+    }
+
+    std::vector<uint64_t> offsets = {0};
+    std::string chars;
+    for (const auto &value : strings)
+    {
+        chars += value;
+        offsets.push_back(chars.size());
+    }
+    header.stringOffset = writeColumn(out, offsets);
+    writeColumn(out, std::vector<char>(chars.begin(), chars.end()));
+    header.rankOffset = writeColumn(out, directory);
+
+    memcpy(header.magic, MTC_MAGIC, 4);
+    header.version = MTC_VERSION;
+    header.numRanks = config.numRanks;
+    header.numStrings = strings.size();
+    out.seekp(0);
+    out.write((const char *)&header, sizeof(header));
+    out.close();
+    std::cout << "Converted " << total << " records of " << config.numRanks << " ranks to " << storePath << std::endl;
+    releaseRanks(rankInfo, config);
+    return 0;
+}
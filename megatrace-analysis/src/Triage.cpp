@@ -0,0 +1,174 @@
+#include "Triage.hpp"
+#include "Findings.hpp"
+#include "LogParser.hpp"
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <algorithm>
+#include <limits>
+#include <atomic>
+#include <thread>
+#include <chrono>
+
+// record index of the first and of the last F/B record of every iteration,
+// as the workers count them: process records are startIdx..endIdx, 1-based
+static std::vector<size_t> boundaryRecords(const std::vector<TrainingProcess> &pattern, size_t iterations)
+{
+    std::vector<size_t> records(iterations * 2, 0);
+    std::vector<bool> seen(iterations, false);
+    for (const auto &process : pattern)
+    {
+        if (process.iteration < 1 || process.iteration > iterations)
+            continue;
+        size_t i = process.iteration - 1;
+        if (!seen[i])
+            records[i * 2] = process.startIdx - 1;
+        seen[i] = true;
+        records[i * 2 + 1] = process.endIdx - 1;
+    }
+    return records;
+}
+
+// timestamps of the records at the ascending indices, 0 past the end of the
+// log; only those lines of a raw log are parsed
+static std::vector<double> readRecords(const std::string &filePath, int rank, TraceStore *store, const std::vector<size_t> &indices)
+{
+    std::vector<double> times(indices.size(), 0);
+    NCCLLog log;
+    if (store != nullptr)
+    {
+        for (size_t i = 0; i < indices.size(); i++)
+            if (store->fetch(rank, indices[i], log) == 0)
+                times[i] = log.timestamp;
+        return times;
+    }
+    std::ifstream file(filePath);
+    std::string line;
+    size_t record = 0, next = 0;
+    while (next < indices.size() && std::getline(file, line))
+    {
+        while (next < indices.size() && indices[next] == record)
+            times[next++] = parseLog(line).timestamp;
+        record++;
+    }
+    return times;
+}
+
+std::vector<int> triageGroups(const TrainingConfig &config, Rank *ranks, TraceStore *store,
+                              const std::vector<std::vector<TrainingProcess>> &trainingPatterns)
+{
+    auto start_time = std::chrono::high_resolution_clock::now();
+    std::vector<std::vector<size_t>> boundaries(config.ppSize);
+    for (int pp = 0; pp < config.ppSize; pp++)
+        boundaries[pp] = boundaryRecords(trainingPatterns[pp], config.iterations);
+
+    std::vector<std::vector<double>> times(config.numRanks);
+    std::atomic<int> next(0);
+    auto scan = [&]
+    {
+        for (int r = next++; r < config.numRanks; r = next++)
+            times[r] = readRecords(config.inputFilePath + "/" + "rank_" + std::to_string(r) + ".log", r, store,
+                                   boundaries[ranks[r].getPp()]);
+    };
+    int workers = std::min<int>(config.numRanks, std::max(1u, std::thread::hardware_concurrency()));
+    std::vector<std::thread> threads;
+    for (int i = 1; i < workers; i++)
+        threads.emplace_back(scan);
+    scan();
+    for (auto &t : threads)
+        t.join();
+
+    int groups = config.ppGroupSize;
+    std::vector<GroupSpan> spans;
+    for (size_t it = 0; it < config.iterations; it++)
+    {
+        std::vector<GroupSpan> row(groups);
+        bool reached = false;
+        for (int g = 0; g < groups; g++)
+            row[g] = {g, it + 1, 0, std::numeric_limits<double>::max(), 0, false};
+        for (int r = 0; r < config.numRanks; r++)
+        {
+            GroupSpan &span = row[ranks[r].getPpGroup()];
+            double begin = times[r][it * 2], end = times[r][it * 2 + 1];
+            reached |= begin != 0;
+            if (end == 0)
+            {
+                span.stopped = true;
+                continue;
+            }
+            span.busy = std::max(span.busy, end - begin);
+            span.spread = std::min(span.spread, end - begin);
+        }
+        // the trace ends before this iteration
+        if (!reached)
+            break;
+
+        std::vector<double> busy;
+        for (auto &span : row)
+        {
+            span.spread = span.busy > 0 && !span.stopped ? span.busy - span.spread : 0;
+            if (!span.stopped && span.busy > 0)
+                busy.push_back(span.busy);
+        }
+        double median = 0;
+        if (!busy.empty())
+        {
+            // lower median: with half the groups slow the reference stays a healthy one
+            std::nth_element(busy.begin(), busy.begin() + (busy.size() - 1) / 2, busy.end());
+            median = busy[(busy.size() - 1) / 2];
+        }
+        for (auto &span : row)
+        {
+            span.ratio = median > 0 && !span.stopped ? span.busy / median : 0;
+            spans.push_back(span);
+        }
+    }
+
+    std::ofstream outFile(config.outputDicPath + "/" + "triage.csv", std::ios::out);
+    if (outFile.is_open())
+    {
+        outFile << "Iteration,PPGroup,Busy,Spread,Ratio,Stopped" << std::endl;
+        outFile << std::fixed << std::setprecision(6);
+        for (const auto &span : spans)
+            outFile << span.iteration << "," << span.ppGroup << "," << span.busy << "," << span.spread << ","
+                    << span.ratio << "," << span.stopped << std::endl;
+    }
+
+    // worst iteration of every group: the first one it stopped in, else the
+    // largest ratio; iterations excluded from the baseline are not scored
+    std::set<int> excluded = parseIterationList(config.excludeIterations);
+    std::vector<const GroupSpan *> worst(groups, nullptr);
+    for (const auto &span : spans)
+    {
+        const GroupSpan *&w = worst[span.ppGroup];
+        if (w != nullptr && w->stopped)
+            continue;
+        if (span.stopped || (!excluded.count(span.iteration) && (w == nullptr || span.ratio > w->ratio)))
+            w = &span;
+    }
+    std::vector<int> order;
+    for (int g = 0; g < groups; g++)
+        if (worst[g] != nullptr)
+            order.push_back(g);
+    std::stable_sort(order.begin(), order.end(), [&](int a, int b)
+                     { return worst[a]->stopped != worst[b]->stopped ? worst[a]->stopped : worst[a]->ratio > worst[b]->ratio; });
+    if ((int)order.size() > config.triageTopK)
+        order.resize(config.triageTopK);
+
+    double seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start_time).count();
+    std::cout << "Triage: " << spans.size() / std::max(groups, 1) << " iterations of " << config.numRanks
+              << " ranks in " << seconds << " seconds, analysing ppGroups";
+    for (int g : order)
+        std::cout << " " << g;
+    std::cout << std::endl;
+    for (int g : order)
+        Finding("triage")
+            .add("PPGROUP", g)
+            .add("ITERATION", worst[g]->iteration)
+            .add("BUSY", worst[g]->busy)
+            .add("SPREAD", worst[g]->spread)
+            .add("RATIO", worst[g]->ratio)
+            .add("STOPPED", worst[g]->stopped)
+            .emit();
+    return order;
+}
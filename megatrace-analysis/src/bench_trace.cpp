@@ -0,0 +1,118 @@
+// Benchmarks the analyzer on a rank_N.log set (e.g. one written by TraceGen):
+// parse throughput of the bulk (parseLogs) and per-record (fetchLog) paths,
+// then end-to-end time and peak RSS of a full Trace run on the set.
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstring>
+#include <climits>
+#include <cstdlib>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+#include "LogParser.hpp"
+using namespace std;
+
+static double secondsSince(chrono::steady_clock::time_point start)
+{
+    return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+static int readNumRanks(const string &configPath)
+{
+    ifstream file(configPath);
+    string line;
+    while (getline(file, line))
+        if (line.rfind("numRanks:", 0) == 0)
+            return stoi(line.substr(9));
+    return -1;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc != 2 && argc != 3)
+    {
+        cerr << "Usage: " << argv[0] << " <trace_dir> [<Trace binary>]" << endl;
+        return 1;
+    }
+    string traceDir = argv[1];
+    string trace = argc == 3 ? argv[2] : "build/Trace";
+    // the child changes directory, so both paths must be absolute
+    char traceResolved[PATH_MAX], dirResolved[PATH_MAX];
+    if (realpath(trace.c_str(), traceResolved) == nullptr || realpath(traceDir.c_str(), dirResolved) == nullptr)
+    {
+        cerr << "Cannot resolve " << trace << " or " << traceDir << endl;
+        return 1;
+    }
+    trace = traceResolved;
+    traceDir = dirResolved;
+
+    int numRanks = readNumRanks(traceDir + "/config.yaml");
+    if (numRanks <= 0)
+    {
+        cerr << "No numRanks in " << traceDir << "/config.yaml" << endl;
+        return 1;
+    }
+
+    // bulk path: read and regex-parse every file
+    size_t records = 0, bytes = 0;
+    auto start = chrono::steady_clock::now();
+    for (int i = 0; i < numRanks; i++)
+    {
+        string path = traceDir + "/rank_" + to_string(i) + ".log";
+        vector<string> lines = readLogsFromFile(path);
+        vector<NCCLLog> parsed;
+        parsed.reserve(lines.size());
+        if (parseLogs(lines, parsed) != 0)
+            return 1;
+        for (const auto &line : lines)
+            bytes += line.size() + 1;
+        records += parsed.size();
+    }
+    double bulkSeconds = secondsSince(start);
+
+    // per-record path the workers use: reopen, seek, parse one line
+    string first = traceDir + "/rank_0.log";
+    size_t firstRecords = readLogsFromFile(first).size();
+    streampos position = 0;
+    NCCLLog log;
+    start = chrono::steady_clock::now();
+    for (size_t i = 0; i < firstRecords; i++)
+        fetchLog(first, position, log);
+    double fetchSeconds = secondsSince(start);
+
+    // end to end: Trace reads config.yaml from its working directory
+    string outputDir = traceDir + "/bench-out";
+    mkdir(outputDir.c_str(), 0755);
+    start = chrono::steady_clock::now();
+    pid_t pid = fork();
+    if (pid == 0)
+    {
+        if (chdir(traceDir.c_str()) != 0)
+            _exit(127);
+        int devNull = open("/dev/null", O_WRONLY);
+        dup2(devNull, STDOUT_FILENO);
+        execl(trace.c_str(), trace.c_str(), traceDir.c_str(), outputDir.c_str(), (char *)nullptr);
+        _exit(127);
+    }
+    int status = 0;
+    struct rusage usage;
+    memset(&usage, 0, sizeof(usage));
+    if (pid < 0 || wait4(pid, &status, 0, &usage) < 0)
+    {
+        cerr << "Cannot run " << trace << endl;
+        return 1;
+    }
+    double endToEnd = secondsSince(start);
+
+    cout << "BENCH: RANKS: " << numRanks << ", RECORDS: " << records << ", BYTES: " << bytes << endl;
+    cout << "BENCH: parseLogs " << records / bulkSeconds << " records/s, " << bytes / bulkSeconds / 1e6 << " MB/s" << endl;
+    cout << "BENCH: fetchLog " << firstRecords / fetchSeconds << " records/s (rank 0, " << firstRecords << " records)" << endl;
+    cout << "BENCH: Trace " << endToEnd << " s, peak RSS " << usage.ru_maxrss / 1024.0 << " MB, exit "
+         << (WIFEXITED(status) ? WEXITSTATUS(status) : -1) << endl;
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0 ? 0 : 1;
+}
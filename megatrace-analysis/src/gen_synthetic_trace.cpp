@@ -0,0 +1,635 @@
+// Synthesizes Megatrace rank_N.log sets (plus a matching config.yaml) for
+// arbitrary TP/PP/DP, layers, GBS and iteration counts. Every rank issues the
+// record layout gen_training_pattern expects; the timeline is a 1F1B pipeline
+// (interleaved with vp > 1 model chunks per rank) per DP replica with TP collectives synchronizing the TP peers, DP
+// collectives synchronizing the replicas and a global sync per iteration.
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <random>
+#include <algorithm>
+#include <iomanip>
+#include <cstdio>
+#include <sys/stat.h>
+#include "Config.hpp"
+#include "Rank.hpp"
+using namespace std;
+
+enum StreamKind
+{
+    MISC,
+    TP,
+    PP,
+    DP,
+    EP
+};
+
+struct RecordSpec
+{
+    string function;
+    long long size;
+    StreamKind stream;
+    double weight; // share of the sublayer compute issued before the record
+    bool expert;   // scaled by the rank's token share: a Recv's size, else its compute
+};
+
+struct Record
+{
+    long long time; // ns
+    const RecordSpec *spec;
+    long long size;
+};
+
+struct Injection
+{
+    int rank;
+    int from;
+    int to;
+    double value;
+    int position;
+};
+
+struct GenConfig
+{
+    TrainingConfig training;
+    unsigned seed;
+    double layerMs;
+    double jitter;
+    double collectiveUs;
+    double p2pUs;
+    vector<Injection> slow;    // rank compute x value in [from, to]
+    vector<Injection> ramp;    // rank compute + value per iteration from `from`
+    vector<Injection> hang;    // rank stops after `position` records of iteration `from`
+    vector<Injection> diverge; // rank issues another size at `position` of iteration `from`
+    vector<Injection> tokens;  // rank receives value x tokens in [from, to]
+    map<int, double> skew;     // rank -> clock offset (s)
+    double skewAll;
+};
+
+static const long long HIDDEN = 33554432;
+static const long long BASE_TIME = 1746686438LL * 1000000000LL;
+
+// one MoE all-to-all: a grouped Send/Recv per EP peer, the first Send
+// issued after `weight` of the sublayer compute
+static void allToAll(vector<RecordSpec> &specs, int epSize, double weight, bool expertRecv, bool expertCompute)
+{
+    for (int p = 0; p < epSize; p++)
+    {
+        specs.push_back({"Send", HIDDEN / epSize, EP, p == 0 ? weight : 0, p == 0 && expertCompute});
+        specs.push_back({"Recv", HIDDEN / epSize, EP, 0, expertRecv});
+    }
+}
+
+// with epSize > 1 every MLP sublayer is an MoE layer: dispatch, experts, combine
+static vector<RecordSpec> forwardLayout(int stage, int ppSize, int layers, bool isSP, int tpSize, int epSize)
+{
+    vector<RecordSpec> specs;
+    auto broadcasts = [&]
+    {
+        specs.push_back({"Broadcast", 32768, TP, 0});
+        specs.push_back({"Broadcast", 16777216, TP, 0});
+        specs.push_back({"Broadcast", 32768, TP, 0});
+    };
+    auto sublayers = [&]
+    {
+        for (int k = 0; k < layers * 2; k++)
+        {
+            bool moe = epSize > 1 && k % 2 == 1;
+            if (isSP)
+                specs.push_back({"AllGather", HIDDEN / tpSize, TP, moe ? 0.1 : 0.2});
+            if (moe)
+            {
+                allToAll(specs, epSize, 0.05, true, false);
+                allToAll(specs, epSize, 0.7, false, true);
+            }
+            if (isSP)
+                specs.push_back({"ReduceScatter", HIDDEN, TP, moe ? 0.15 : 0.8});
+            else
+                specs.push_back({"AllReduce", HIDDEN, TP, moe ? 0.25 : 1});
+        }
+    };
+    if (stage == 0)
+    {
+        broadcasts();
+        specs.push_back({"AllReduce", HIDDEN, TP, 0.1});
+        sublayers();
+        specs.push_back({"Send", HIDDEN, PP, 0});
+    }
+    else if (stage == ppSize - 1)
+    {
+        specs.push_back({"Recv", HIDDEN, PP, 0});
+        broadcasts();
+        sublayers();
+        if (isSP)
+            specs.push_back({"AllGather", HIDDEN / tpSize, TP, 0.1});
+        for (int k = 0; k < 3; k++)
+            specs.push_back({"AllReduce", 4096, TP, 0.05});
+        if (!isSP)
+            specs.push_back({"AllReduce", 1, MISC, 0});
+    }
+    else
+    {
+        specs.push_back({"Recv", HIDDEN, PP, 0});
+        sublayers();
+        specs.push_back({"Send", HIDDEN, PP, 0});
+    }
+    return specs;
+}
+
+// the gradients run backwards: combine first, then dispatch
+static vector<RecordSpec> backwardLayout(int stage, int ppSize, int layers, bool isSP, int tpSize, int epSize)
+{
+    vector<RecordSpec> specs;
+    auto sublayers = [&]
+    {
+        for (int k = 0; k < layers * 2; k++)
+        {
+            bool moe = epSize > 1 && k % 2 == 1;
+            if (isSP)
+            {
+                specs.push_back({"AllGather", HIDDEN / tpSize, TP, 0.3});
+                specs.push_back({"AllGather", HIDDEN / tpSize, TP, 0.3});
+            }
+            if (moe)
+            {
+                allToAll(specs, epSize, 0.1, true, false);
+                allToAll(specs, epSize, 1.4, false, true);
+            }
+            if (isSP)
+                specs.push_back({"ReduceScatter", HIDDEN, TP, moe ? 0.2 : 1.4});
+            else
+                specs.push_back({"AllReduce", HIDDEN, TP, moe ? 0.5 : 2});
+        }
+    };
+    if (stage == 0)
+    {
+        specs.push_back({"Recv", HIDDEN, PP, 0});
+        sublayers();
+        if (isSP)
+            specs.push_back({"AllGather", HIDDEN / tpSize, TP, 0.1});
+    }
+    else if (stage == ppSize - 1)
+    {
+        if (isSP)
+        {
+            specs.push_back({"AllGather", HIDDEN / tpSize, TP, 0.1});
+            specs.push_back({"ReduceScatter", HIDDEN, TP, 0.1});
+        }
+        else
+            specs.push_back({"AllReduce", HIDDEN, TP, 0.1});
+        sublayers();
+        specs.push_back({"Send", HIDDEN, PP, 0});
+    }
+    else
+    {
+        specs.push_back({"Recv", HIDDEN, PP, 0});
+        sublayers();
+        specs.push_back({"Send", HIDDEN, PP, 0});
+    }
+    return specs;
+}
+
+// the 16 records before the first process (uselessLogEndIdx)
+static vector<RecordSpec> preambleLayout()
+{
+    vector<RecordSpec> specs(10, {"AllReduce", 1, MISC, 0});
+    specs.push_back({"Broadcast", 24, MISC, 0});
+    specs.push_back({"AllReduce", 1, MISC, 0});
+    specs.push_back({"AllReduce", 1, MISC, 0});
+    specs.push_back({"AllGather", 8, MISC, 0});
+    specs.push_back({"AllReduce", 1, MISC, 0});
+    specs.push_back({"AllReduce", 1, MISC, 0});
+    return specs;
+}
+
+// gradient sync and optimizer step after the last process (batchFinishLogSize)
+static vector<RecordSpec> finishLayout(bool isSP)
+{
+    vector<RecordSpec> specs = {
+        {"ReduceScatter", 260718592, DP, 0},
+        {"AllReduce", 1, MISC, 0},
+        {"AllGather", 521437184, DP, 0},
+        {"AllGather", 96, MISC, 0},
+        {"AllReduce", 1, MISC, 0},
+        {"AllReduce", 1, MISC, 0},
+        {"AllGather", 96, MISC, 0}};
+    if (isSP)
+        specs.push_back({"AllReduce", 1, MISC, 0});
+    return specs;
+}
+
+// "3F1" -> (3, 'F', virtual stage 1)
+static void parseProcessName(const string &name, const TrainingConfig &config, int &batch, char &direction, int &stage)
+{
+    parseProcessName(name, batch, direction);
+    stage = virtualStage(name, config.ppSize, config.vpSize);
+}
+
+static vector<int> parseInts(const string &value, char separator)
+{
+    vector<int> values;
+    stringstream in(value);
+    string item;
+    while (getline(in, item, separator))
+        values.push_back(stoi(item));
+    return values;
+}
+
+// RANK:FROM-TO:VALUE, RANK:ITER:VALUE or RANK:ITER:POSITION
+static Injection parseInjection(const string &value)
+{
+    Injection injection = {0, 0, 0, 0, 0};
+    vector<string> fields;
+    stringstream in(value);
+    string item;
+    while (getline(in, item, ':'))
+        fields.push_back(item);
+    if (fields.size() != 3)
+        throw invalid_argument(value);
+    injection.rank = stoi(fields[0]);
+    vector<int> range = parseInts(fields[1], '-');
+    injection.from = range.front();
+    injection.to = range.back();
+    injection.value = stod(fields[2]);
+    injection.position = (int)injection.value;
+    return injection;
+}
+
+static int usage(const char *name)
+{
+    cerr << "Usage: " << name << " <output_dir> [key=value ...]" << endl
+         << "  tp=2 pp=4 dp=8 vp=1 ep=1 layers=32 GBS=64 iterations=10 sp=0 seed=1" << endl
+         << "  layerMs=2 jitter=0.02 collectiveUs=300 p2pUs=500" << endl
+         << "  slow=RANK:FROM-TO:FACTOR     compute of RANK x FACTOR" << endl
+         << "  ramp=RANK:FROM:FRACTION      compute of RANK + FRACTION per iteration" << endl
+         << "  hang=RANK:ITER:RECORDS       RANK stops after RECORDS records of ITER" << endl
+         << "  diverge=RANK:ITER:RECORD     RANK issues another size at RECORD of ITER" << endl
+         << "  tokens=RANK:FROM-TO:FACTOR   RANK's experts get FACTOR x tokens (ep > 1)" << endl
+         << "  skew=RANK:SECONDS | skew=*:SECONDS (uniform per rank)" << endl;
+    return 1;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 2)
+        return usage(argv[0]);
+    string outputDir = argv[1];
+
+    GenConfig gen = {};
+    TrainingConfig &config = gen.training;
+    config.isSP = false;
+    config.layers = 32;
+    config.ppSize = 4;
+    config.tpSize = 2;
+    config.GBS = 64;
+    config.headers = 32;
+    config.iterations = 10;
+    config.vpSize = 1;
+    config.epSize = 1;
+    int dpSize = 8;
+    gen.seed = 1;
+    gen.layerMs = 2;
+    gen.jitter = 0.02;
+    gen.collectiveUs = 300;
+    gen.p2pUs = 500;
+    gen.skewAll = 0;
+
+    try
+    {
+        for (int i = 2; i < argc; i++)
+        {
+            string arg = argv[i];
+            size_t eq = arg.find('=');
+            if (eq == string::npos)
+                return usage(argv[0]);
+            string key = arg.substr(0, eq), value = arg.substr(eq + 1);
+            if (key == "tp")
+                config.tpSize = stoi(value);
+            else if (key == "pp")
+                config.ppSize = stoi(value);
+            else if (key == "dp")
+                dpSize = stoi(value);
+            else if (key == "vp")
+                config.vpSize = stoi(value);
+            else if (key == "ep")
+                config.epSize = stoi(value);
+            else if (key == "layers")
+                config.layers = stoi(value);
+            else if (key == "GBS")
+                config.GBS = stoi(value);
+            else if (key == "iterations")
+                config.iterations = stoi(value);
+            else if (key == "sp")
+                config.isSP = value == "1" || value == "true";
+            else if (key == "seed")
+                gen.seed = stoul(value);
+            else if (key == "layerMs")
+                gen.layerMs = stod(value);
+            else if (key == "jitter")
+                gen.jitter = stod(value);
+            else if (key == "collectiveUs")
+                gen.collectiveUs = stod(value);
+            else if (key == "p2pUs")
+                gen.p2pUs = stod(value);
+            else if (key == "slow")
+                gen.slow.push_back(parseInjection(value));
+            else if (key == "ramp")
+                gen.ramp.push_back(parseInjection(value));
+            else if (key == "hang")
+                gen.hang.push_back(parseInjection(value));
+            else if (key == "diverge")
+                gen.diverge.push_back(parseInjection(value));
+            else if (key == "tokens")
+                gen.tokens.push_back(parseInjection(value));
+            else if (key == "skew")
+            {
+                size_t colon = value.find(':');
+                if (colon == string::npos)
+                    return usage(argv[0]);
+                if (value.substr(0, colon) == "*")
+                    gen.skewAll = stod(value.substr(colon + 1));
+                else
+                    gen.skew[stoi(value.substr(0, colon))] = stod(value.substr(colon + 1));
+            }
+            else
+                return usage(argv[0]);
+        }
+    }
+    catch (const exception &e)
+    {
+        cerr << "Invalid argument: " << e.what() << endl;
+        return usage(argv[0]);
+    }
+
+    config.numRanks = config.tpSize * config.ppSize * dpSize;
+    config.vpSize = max(config.vpSize, 1);
+    int layers = config.layers / (config.ppSize * config.vpSize);
+    if (config.ppSize < 2 || layers < 1 || config.GBS % dpSize != 0 || config.GBS / dpSize < config.ppSize)
+    {
+        cerr << "Need pp >= 2, layers >= pp * vp and GBS / dp >= pp microbatches" << endl;
+        return 1;
+    }
+    if (config.vpSize > 1 && ((config.GBS / dpSize) % config.ppSize != 0 || config.layers % (config.ppSize * config.vpSize) != 0))
+    {
+        cerr << "Need GBS / dp and layers divisible by pp and pp * vp with vp > 1" << endl;
+        return 1;
+    }
+    if (config.epSize < 1 || dpSize % config.epSize != 0)
+    {
+        cerr << "Need ep to divide dp" << endl;
+        return 1;
+    }
+    Rank *ranks = initRanks(config);
+    vector<vector<TrainingProcess>> patterns = gen_training_pattern(config);
+    mkdir(outputDir.c_str(), 0755);
+
+    int numRanks = config.numRanks;
+    int stageRanks = numRanks / config.ppSize;
+    mt19937_64 rng(gen.seed);
+    uniform_real_distribution<double> noise(-gen.jitter, gen.jitter);
+    uniform_real_distribution<double> offsets(-gen.skewAll, gen.skewAll);
+
+    vector<long long> clockOffset(numRanks, 0);
+    for (int r = 0; r < numRanks; r++)
+    {
+        double offset = gen.skew.count(r) ? gen.skew[r] : (gen.skewAll > 0 ? offsets(rng) : 0);
+        clockOffset[r] = (long long)(offset * 1e9);
+    }
+
+    // per virtual stage: chunk c of stage s is c * pp + s
+    int virtualNum = config.ppSize * config.vpSize;
+    vector<vector<RecordSpec>> forward(virtualNum), backward(virtualNum);
+    for (int v = 0; v < virtualNum; v++)
+    {
+        forward[v] = forwardLayout(v, virtualNum, layers, config.isSP, config.tpSize, config.epSize);
+        backward[v] = backwardLayout(v, virtualNum, layers, config.isSP, config.tpSize, config.epSize);
+    }
+    vector<RecordSpec> preamble = preambleLayout(), finish = finishLayout(config.isSP);
+
+    auto streamName = [](int rank, StreamKind kind)
+    {
+        char buffer[32];
+        snprintf(buffer, sizeof(buffer), "0x55%04x%02x%04x", rank & 0xffff, (rank >> 16) & 0xff, 0x1000 * (kind + 1));
+        return string(buffer);
+    };
+    auto computeFactor = [&](int rank, int iteration)
+    {
+        double factor = 1;
+        for (const auto &slow : gen.slow)
+            if (slow.rank == rank && iteration >= slow.from && iteration <= slow.to)
+                factor *= slow.value;
+        for (const auto &ramp : gen.ramp)
+            if (ramp.rank == rank && iteration >= ramp.from)
+                factor *= 1 + ramp.value * (iteration - ramp.from + 1);
+        return factor;
+    };
+    auto tokenFactor = [&](int rank, int iteration)
+    {
+        double factor = 1;
+        for (const auto &tokens : gen.tokens)
+            if (tokens.rank == rank && iteration >= tokens.from && iteration <= tokens.to)
+                factor *= tokens.value;
+        return factor;
+    };
+
+    long long collectiveNs = (long long)(gen.collectiveUs * 1e3), p2pNs = (long long)(gen.p2pUs * 1e3);
+    long long sublayerNs = (long long)(gen.layerMs * 1e6);
+    long long smallNs = 20000;
+
+    // hang: the time the hanging rank stopped, every other rank stops after
+    // its first record past it
+    long long hangTime = -1;
+    int hangIteration = -1;
+    vector<bool> stopped(numRanks, false);
+
+    // preamble, one second apart, shared by all ranks
+    long long now = BASE_TIME;
+    vector<vector<Record>> records(numRanks);
+    for (const auto &spec : preamble)
+    {
+        now += 100000000;
+        for (int r = 0; r < numRanks; r++)
+            records[r].push_back({now + smallNs * (r % 7), &spec, spec.size});
+    }
+    now += 1000000000;
+
+    auto flush = [&](bool truncate)
+    {
+        for (int r = 0; r < numRanks; r++)
+        {
+            ofstream file(outputDir + "/rank_" + to_string(r) + ".log", ios::app);
+            for (const auto &record : records[r])
+            {
+                if (stopped[r])
+                    break;
+                long long t = record.time + clockOffset[r];
+                file << "[" << t / 1000000000 << "." << setfill('0') << setw(9) << t % 1000000000 << setfill(' ') << "] [Rank " << r
+                     << "] Fun " << record.spec->function << " Data " << record.size << " stream "
+                     << streamName(r, record.spec->stream) << "\n";
+                if (truncate && record.time > hangTime)
+                    stopped[r] = true;
+            }
+            records[r].clear();
+        }
+    };
+    for (int r = 0; r < numRanks; r++)
+        remove((outputDir + "/rank_" + to_string(r) + ".log").c_str());
+    flush(false);
+
+    size_t totalRecords = 0;
+    for (int iteration = 1; iteration <= (int)config.iterations && hangIteration < 0; iteration++)
+    {
+        long long iterationStart = now;
+        vector<long long> stageEnd(numRanks, iterationStart);
+
+        // one 1F1B pipeline per DP replica; the TP peers of a stage move together
+        for (int replica = 0; replica < dpSize; replica++)
+        {
+            // stage -> process list of this iteration
+            vector<vector<const TrainingProcess *>> processes(config.ppSize);
+            for (int s = 0; s < config.ppSize; s++)
+                for (const auto &process : patterns[s])
+                    if ((int)process.iteration == iteration)
+                        processes[s].push_back(&process);
+            int microbatches = config.GBS / dpSize;
+            vector<vector<long long>> forwardSend(virtualNum, vector<long long>(microbatches + 1, -1));
+            vector<vector<long long>> backwardSend(virtualNum, vector<long long>(microbatches + 1, -1));
+            vector<long long> stageFree(config.ppSize, iterationStart);
+            vector<size_t> next(config.ppSize, 0);
+
+            auto members = [&](int stage)
+            {
+                vector<int> group;
+                for (int t = 0; t < config.tpSize; t++)
+                    group.push_back(replica * config.tpSize + t + stage * stageRanks);
+                return group;
+            };
+
+            bool progress = true;
+            while (progress)
+            {
+                progress = false;
+                for (int s = 0; s < config.ppSize; s++)
+                {
+                    while (next[s] < processes[s].size())
+                    {
+                        int batch, v;
+                        char direction;
+                        parseProcessName(processes[s][next[s]]->name, config, batch, direction, v);
+                        long long ready = stageFree[s];
+                        if (direction == 'F' && v > 0)
+                        {
+                            if (forwardSend[v - 1][batch] < 0)
+                                break;
+                            ready = forwardSend[v - 1][batch] + p2pNs;
+                        }
+                        if (direction == 'B' && v < virtualNum - 1)
+                        {
+                            if (backwardSend[v + 1][batch] < 0)
+                                break;
+                            ready = backwardSend[v + 1][batch] + p2pNs;
+                        }
+
+                        const vector<RecordSpec> &specs = direction == 'F' ? forward[v] : backward[v];
+                        vector<int> group = members(s);
+                        long long done = stageFree[s];
+                        for (const auto &spec : specs)
+                        {
+                            long long latest = 0;
+                            vector<long long> issue(group.size());
+                            for (size_t t = 0; t < group.size(); t++)
+                            {
+                                int r = group[t];
+                                double expert = spec.expert ? tokenFactor(r, iteration) : 1;
+                                long long gap = spec.weight > 0
+                                                    ? (long long)(sublayerNs * spec.weight * expert * computeFactor(r, iteration) * (1 + noise(rng)))
+                                                    : (long long)(smallNs * (1 + noise(rng)));
+                                // a PP Recv is posted before its data is ready
+                                issue[t] = spec.stream == PP && spec.function == "Recv" ? stageFree[s] + smallNs : done + gap;
+                                latest = max(latest, issue[t]);
+                            }
+                            for (size_t t = 0; t < group.size(); t++)
+                            {
+                                long long size = spec.size;
+                                if (spec.expert && spec.function == "Recv")
+                                    size = (long long)(size * tokenFactor(group[t], iteration));
+                                for (const auto &diverge : gen.diverge)
+                                    if (diverge.rank == group[t] && diverge.from == iteration &&
+                                        diverge.position == (int)records[group[t]].size() + 1)
+                                        size = max(1LL, size / 2);
+                                records[group[t]].push_back({issue[t], &spec, size});
+                            }
+                            if (spec.stream == PP && spec.function == "Recv")
+                                done = max(latest, ready);
+                            else if (spec.stream == PP && spec.function == "Send")
+                                done = latest;
+                            else
+                                done = latest + (spec.stream == TP && spec.weight > 0 ? collectiveNs : smallNs);
+                            if (spec.stream == PP && spec.function == "Send")
+                                (direction == 'F' ? forwardSend : backwardSend)[v][batch] = latest;
+                        }
+                        stageFree[s] = done;
+                        next[s]++;
+                        progress = true;
+                    }
+                }
+            }
+            for (int s = 0; s < config.ppSize; s++)
+                for (int r : members(s))
+                    stageEnd[r] = stageFree[s];
+        }
+
+        // gradient ReduceScatter/AllGather per DP group, then a global sync
+        map<int, long long> dpDone;
+        for (int r = 0; r < numRanks; r++)
+            dpDone[ranks[r].getDpGroup()] = max(dpDone[ranks[r].getDpGroup()], stageEnd[r] + smallNs);
+        long long globalEnd = 0;
+        for (int r = 0; r < numRanks; r++)
+        {
+            long long t = stageEnd[r];
+            for (const auto &spec : finish)
+            {
+                t = spec.stream == DP && spec.function == "ReduceScatter" ? t + smallNs
+                    : spec.stream == DP                                   ? max(t, dpDone[ranks[r].getDpGroup()]) + 5 * collectiveNs
+                                                                          : t + smallNs;
+                records[r].push_back({t, &spec, spec.size});
+            }
+            globalEnd = max(globalEnd, t);
+        }
+        now = globalEnd + 5 * smallNs;
+
+        for (const auto &hang : gen.hang)
+        {
+            if (hang.from != iteration || hang.rank < 0 || hang.rank >= numRanks)
+                continue;
+            int position = max(1, min(hang.position, (int)records[hang.rank].size()));
+            hangTime = records[hang.rank][position - 1].time;
+            records[hang.rank].resize(position);
+            hangIteration = iteration;
+        }
+        for (int r = 0; r < numRanks; r++)
+            totalRecords += records[r].size();
+        flush(hangIteration >= 0);
+    }
+
+    ofstream yaml(outputDir + "/config.yaml", ios::out);
+    yaml << "isSP: " << (config.isSP ? "true" : "false") << endl
+         << "layers: " << config.layers << endl
+         << "ppSize: " << config.ppSize << endl
+         << "vpSize: " << config.vpSize << endl
+         << "epSize: " << config.epSize << endl
+         << "tpSize: " << config.tpSize << endl
+         << "GBS: " << config.GBS << endl
+         << "headers: " << config.headers << endl
+         << "numRanks: " << numRanks << endl
+         << "iterations: " << config.iterations << endl
+         << "slowThreshold: 1" << endl;
+    cout << "[GEN] " << numRanks << " ranks, " << totalRecords << " records (" << (hangIteration >= 0 ? "hang in iteration " + to_string(hangIteration) : "no hang")
+         << ") written to " << outputDir << endl;
+
+    releaseRanks(ranks, config);
+    return 0;
+}
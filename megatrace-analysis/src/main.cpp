@@ -7,6 +7,9 @@
 #include "LogParser.hpp"
 #include "Rank.hpp"
 #include "Config.hpp"
+#include "LinkMatrix.hpp"
+#include "TraceStore.hpp"
+#include "OutputSink.hpp"
 using namespace std;
 
 // 64rank training set
@@ -99,14 +102,31 @@ int main(int argc, char *argv[])
 {
     string configFile = "config.yaml";
 
-    if (argc != 3)
+    // Trace cat <output.mta> [<entry>]
+    if (argc >= 2 && string(argv[1]) == "cat")
     {
-        cerr << "Usage: " << argv[0] << " <log_file_path> " << "<output_file_path> " << endl;
+        if (argc != 3 && argc != 4)
+        {
+            cerr << "Usage: " << argv[0] << " cat <output.mta> " << "[<entry>] " << endl;
+            return 1;
+        }
+        return runCat(argv[2], argc == 4 ? argv[3] : "");
+    }
+
+    // Trace telemetry <telemetry_dir> <output_file_path> [<log_file_path>]
+    // Trace convert <log_file_path> <store.mtc>
+    bool isTelemetryMode = argc >= 2 && string(argv[1]) == "telemetry";
+    bool isConvertMode = argc >= 2 && string(argv[1]) == "convert";
+    if (isTelemetryMode ? (argc != 4 && argc != 5) : argc != (isConvertMode ? 4 : 3))
+    {
+        cerr << "Usage: " << argv[0] << " <log_file_path | store.mtc> " << "<output_file_path> " << endl;
+        cerr << "       " << argv[0] << " telemetry <telemetry_dir> " << "<output_file_path> " << "[<log_file_path>]" << endl;
+        cerr << "       " << argv[0] << " convert <log_file_path> " << "<store.mtc> " << endl;
         return 1;
     }
 
-    string inputFilePath = argv[1];
-    string outputDicPath = argv[2];
+    string inputFilePath = isTelemetryMode ? (argc == 5 ? argv[4] : "") : argv[isConvertMode ? 2 : 1];
+    string outputDicPath = isTelemetryMode || isConvertMode ? argv[3] : argv[2];
    // double slowThreshold = stod(argv[3]);
 
     Rank *ranks = nullptr;
@@ -123,8 +143,48 @@ int main(int argc, char *argv[])
         .headers = getConfigValue(yamlConfig, "headers", 32),
         .numRanks = getConfigValue(yamlConfig, "numRanks", 512),
         .iterations = getConfigValue(yamlConfig, "iterations", 50),
-        .slowThreshold = getConfigValue(yamlConfig, "slowThreshold", 1) 
+        .slowThreshold = getConfigValue(yamlConfig, "slowThreshold", 1),
+        .telemetryPath = getConfigValue(yamlConfig, "telemetryPath", std::string("")),
+        .telemetryWindow = getConfigValue(yamlConfig, "telemetryWindow", 1.0),
+        .linkSlowRatio = getConfigValue(yamlConfig, "linkSlowRatio", 0.5),
+        .layerSlowRatio = getConfigValue(yamlConfig, "layerSlowRatio", 1.2),
+        .baselineEstimator = getConfigValue(yamlConfig, "baselineEstimator", std::string("mean")),
+        .ewmaAlpha = getConfigValue(yamlConfig, "ewmaAlpha", 0.1),
+        .baselineWarmup = getConfigValue(yamlConfig, "baselineWarmup", 2),
+        .madThreshold = getConfigValue(yamlConfig, "madThreshold", 0.0),
+        .excludeIterations = getConfigValue(yamlConfig, "excludeIterations", std::string("1")),
+        .baselinePath = getConfigValue(yamlConfig, "baselinePath", std::string("")),
+        .driftWarmup = getConfigValue(yamlConfig, "driftWarmup", 5),
+        .driftDelta = getConfigValue(yamlConfig, "driftDelta", 0.01),
+        .driftThreshold = getConfigValue(yamlConfig, "driftThreshold", 0.2),
+        .liveDeadline = getConfigValue(yamlConfig, "liveDeadline", 0.0),
+        .whatIfRanks = getConfigValue(yamlConfig, "whatIfRanks", std::string("")),
+        .chromeTrace = getConfigValue(yamlConfig, "chromeTrace", false),
+        .ganttChart = getConfigValue(yamlConfig, "ganttChart", false),
+        .outputArchive = getConfigValue(yamlConfig, "outputArchive", false),
+        .archiveCompress = getConfigValue(yamlConfig, "archiveCompress", true),
+        .triageTopK = getConfigValue(yamlConfig, "triageTopK", 0),
+        .checkpointPath = getConfigValue(yamlConfig, "checkpointPath", std::string("")),
+        .learnPattern = getConfigValue(yamlConfig, "learnPattern", true),
+        .vpSize = getConfigValue(yamlConfig, "vpSize", 1),
+        .epSize = getConfigValue(yamlConfig, "epSize", 1),
+        .tokenImbalanceRatio = getConfigValue(yamlConfig, "tokenImbalanceRatio", 1.2),
+        .alltoallSkewRatio = getConfigValue(yamlConfig, "alltoallSkewRatio", 0.2),
+        .layerMinExcess = getConfigValue(yamlConfig, "layerMinExcess", 0.001)
     };
+    // the interleaved schedule splits the microbatches into groups of ppSize
+    // and every stage's layers into vpSize chunks
+    int microbatches = config.GBS / (config.numRanks / (config.tpSize * config.ppSize));
+    if (config.vpSize < 1 || (config.vpSize > 1 && (microbatches % config.ppSize != 0 || config.layers % (config.ppSize * config.vpSize) != 0)))
+    {
+        std::cerr << "vpSize " << config.vpSize << " does not divide the microbatches and layers, using the non-interleaved schedule" << std::endl;
+        config.vpSize = 1;
+    }
+
+    if (isTelemetryMode)
+        return runTelemetryAnalysis(argv[2], config);
+    if (isConvertMode)
+        return runConvert(inputFilePath, outputDicPath, config);
     // cout<<config.isSP<<endl;
     // cout<<config.layers<<endl;
     // cout<<config.ppSize<<endl;
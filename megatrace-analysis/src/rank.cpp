@@ -9,12 +9,20 @@ Rank *initRanks(TrainingConfig &config)
     Rank *ranks;
 
     config.dpSize = config.numRanks / (config.tpSize * config.ppSize);
+    // expert parallelism splits each DP group into groups of epSize
+    // consecutive DP ranks
+    if (config.epSize < 1 || config.dpSize % config.epSize != 0)
+    {
+        cerr << "epSize " << config.epSize << " does not divide dpSize " << config.dpSize << ", ignoring it" << endl;
+        config.epSize = 1;
+    }
 
     ranks = new Rank[config.numRanks];
 
     config.tpGroupSize = config.numRanks / config.tpSize;
     config.ppGroupSize = config.numRanks / config.ppSize;
     config.dpGroupSize = config.numRanks / config.dpSize;
+    config.epGroupSize = config.numRanks / config.epSize;
 
     for (int i = 0; i < config.numRanks; ++i)
     {
@@ -44,6 +52,8 @@ Rank *initRanks(TrainingConfig &config)
         }
         ranks[i].setDp((i / (config.tpSize)) % config.dpSize);
         ranks[i].setDpGroup((i / (config.tpSize * config.dpSize)) * config.tpSize + i % config.tpSize);
+        ranks[i].setEp(ranks[i].getDp() % config.epSize);
+        ranks[i].setEpGroup(ranks[i].getDpGroup() * (config.dpSize / config.epSize) + ranks[i].getDp() / config.epSize);
     }
     return ranks;
 }
@@ -62,6 +72,8 @@ void Rank::printRankInfo()
     std::cout << "PP Group: " << pp_group << std::endl;
     std::cout << "DP: " << dp << std::endl;
     std::cout << "DP Group: " << dp_group << std::endl;
+    std::cout << "EP: " << ep << std::endl;
+    std::cout << "EP Group: " << ep_group << std::endl;
     std::cout << "N Rank: " << n_rank << std::endl;
     std::cout << "Next PP: " << next_pp << std::endl;
     std::cout << "Is First PP: " << (is_first_pp ? "true" : "false") << std::endl;
@@ -571,6 +571,7 @@ static ncclResult_t addP2pToPlan(
   
   proxyOp.ncclFuncTimes = ncclFuncTimes;
   proxyOp.groupHash = groupHash;
+  proxyOp.commHash = comm->commHash;
   proxyOp.coll = info.coll;
   
   NCCLCHECK(addProxyOpIfNeeded(comm, plan, &proxyOp));
@@ -1792,6 +1793,7 @@ static ncclResult_t computeCollChunkInfo(struct ncclInfo* collInfo, size_t nByte
 
 static ncclResult_t initCollProxyOp(struct ncclInfo* collInfo, int channelId, uint64_t opCount, uint32_t nsteps, struct ncclProxyOp* proxyOp) {
   proxyOp->groupHash = collInfo->comm->groupHash;
+  proxyOp->commHash = collInfo->comm->commHash;
   proxyOp->ncclFuncTimes = collInfo->ncclFuncTimes;
   proxyOp->nsteps = nsteps;
   proxyOp->sliceSteps = collInfo->sliceSteps;
@@ -2044,10 +2046,11 @@ ncclResult_t ncclEnqueueCheck(struct ncclInfo* info) {
         info->datatype, info->op, info->root, info->comm, info->comm->nRanks, info->stream);
   
    //jfz: 在这里统一记录时间和操作
+  // CLOCK_REALTIME so records line up with the telemetry timestamps
   struct timespec time_api;
-  clock_gettime(CLOCK_MONOTONIC, &time_api);
+  clock_gettime(CLOCK_REALTIME, &time_api);
   if(nccl_megatrace_enable){
-    log_event(time_api, info->count, info->opName, info->stream);
+    log_event(time_api, info->count, info->opName, info->stream, info->comm->commHash, info->ncclFuncTimes);
   }
   TRACE_CALL("nccl%s(%" PRIx64 ",%" PRIx64 ",%zi,%d,%d,%d,%p,%p)", info->opName, reinterpret_cast<int64_t>(info->sendbuff), reinterpret_cast<int64_t>(info->recvbuff), info->count, info->datatype, info->op, info->root, info->comm, info->stream);
 
@@ -61,6 +61,7 @@ struct ncclProxyOp {
   int peerRank;
   int rank;
   uint64_t groupHash;
+  uint64_t commHash;
 };
 
 struct ncclProxySubArgs {
@@ -127,6 +128,7 @@ struct ncclProxyArgs {
   int peerRank;
   int rank;
   uint64_t groupHash;
+  uint64_t commHash;
 };
 #define NCCL_MAX_NETDEVS 128
 
@@ -20,7 +20,7 @@
 
 
 #define RING_BUFFER_SIZE 40960  // 环形缓冲区的大小
-#define LOG_MAX_LEN 128       // 日志条目大小
+#define LOG_MAX_LEN 160       // 日志条目大小
 #define BATCH_SIZE        5000      // 子线程每次批量处理日志的条数
 #define FLUSH_INTERVAL_US 3000000 // 定时刷新间隔（单位：微秒，这里设置为100ms）
 #define MEGATRACE_LOG_ENABLE           1
@@ -55,7 +55,7 @@ int ring_buffer_count(ring_buffer_t *rb) ;
 int ring_buffer_push(ring_buffer_t *rb, const char *msg);
 int ring_buffer_pop_batch(ring_buffer_t *rb, log_entry_t *out_entries, int max_entries) ;
 void *log_writer_thread(void *arg) ;
-void log_event(struct timespec time_api, size_t count, const char* opName, cudaStream_t stream);
+void log_event(struct timespec time_api, size_t count, const char* opName, cudaStream_t stream, uint64_t commHash, unsigned long long opCount);
 
 
 
@@ -40,9 +40,12 @@ struct timer_log{
   std::string NetworkCardName;
   int peerRank;
   uint64_t groupHash;
+  uint64_t commHash;       // shared with the Megatrace record "comm" field, FuncTimes is its "op"
   int sendWrCounter;
   int devIndex;
   int remainWrDataSize;
+  int sockIndex;           // net_socket: data socket of the first sub-task, -1 when the control socket carried it
+  int helperThread;        // net_socket: helper thread that progressed it, -1 for the proxy thread (both -1 on IB)
 };
 
 // define the size of windowsSize
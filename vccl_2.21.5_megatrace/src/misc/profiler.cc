@@ -5,111 +5,164 @@
  ************************************************************************/
 
 #include "profiler.h"
+#include "param.h"
+#include "debug.h"
+#include <errno.h>
+#include <limits.h>
+#include <string.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
 
-//#define PROFILE_PROXY 1
-#ifdef PROFILE_PROXY
-#include "timer.h"
-#include "alloc.h"
+// Proxy step profiler, enabled at runtime with NCCL_PROXY_PROFILE=<path>.
+//
+// Every call appends one fixed-size state transition record to a buffer owned
+// by the calling thread, so recording takes no lock. A full buffer is written
+// as one binary chunk to <path>.<pid> under a mutex; buffers are also flushed
+// when their thread exits and on ncclProfilingDump(). Records carry commHash
+// and ncclFuncTimes so they can be joined with Megatrace and telemetry records.
+// src/tools/proxy_profile_to_json.py converts the file to Chrome/Perfetto JSON.
+//
+// NCCL_PROXY_PROFILE_MAX_MB bounds the file size (default 256); once reached,
+// recording stops, which keeps the profiler usable for short production windows.
+
+#define PROFILE_MAGIC 0x464f5250584f5250ULL // "PROXPROF"
+#define PROFILE_VERSION 1
+#define PROFILE_CHUNK_EVENTS 4096
+
+struct ncclProxyProfileFileHeader {
+  uint64_t magic;
+  uint32_t version;
+  uint32_t eventSize;
+  int32_t pid;
+  int32_t pad;
+};
+
+struct ncclProxyProfileChunkHeader {
+  uint32_t tid;
+  uint32_t count;
+};
 
-static const char* profilingStateSendStr[] = { "BufferWait", "GPUWait", "SendWait", "", "End" };
-static const char* profilingStateRecvStr[] = { "BufferWait", "RecvWait", "FlushWait", "GPUWait", "End" };
-static const char* profilingEventStr[] = { "SendRecv", "Sleep", "Idle", "Append" };
 struct ncclProxyProfileEvent {
-  double timestamp[6];
-  uint64_t opCount;
-  int peer;
-  int step;
+  uint64_t timestamp;   // CLOCK_REALTIME ns, same clock as Megatrace records
+  uint64_t commHash;
+  uint64_t funcTimes;   // comm->ncclFuncTimes of the operation
+  uint64_t opCount;     // proxy op count, or ops added for AppendEnd
+  uint64_t argsId;      // identifies the proxy args so states of one step can be paired
+  int32_t peer;
+  int32_t step;
   uint16_t channel;
-  uint8_t type; // send / recv
-  uint8_t opIndex;
+  uint8_t type;         // ncclPatternSend / ncclPatternRecv
+  uint8_t state;        // ncclProxyProfileState
+  uint32_t pad;
 };
 
-struct ncclProxyProfileEvent* profilingEvents = NULL;
-int profilingIndex = 0;
-double profilingStart = 0;
-#define MAX_EVENTS 200000
+static int profilingEnabled = 0;
+static FILE* profilingFile = NULL;
+static uint64_t profilingBytes = 0;
+static uint64_t profilingMaxBytes = 0;
+static pthread_mutex_t profilingMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t profilingOnce = PTHREAD_ONCE_INIT;
 
-ncclResult_t ncclProfilingRecord(struct ncclProxyArgs* args, int sub, int step, int state) {
-  if (profilingEvents == NULL) {
-    NCCLCHECK(ncclCalloc(&profilingEvents, MAX_EVENTS));
-    profilingStart = gettime();
+static void profilingWriteChunk(uint32_t tid, struct ncclProxyProfileEvent* events, int count) {
+  if (count == 0) return;
+  struct ncclProxyProfileChunkHeader header = { tid, (uint32_t)count };
+  size_t bytes = sizeof(header) + count*sizeof(struct ncclProxyProfileEvent);
+  pthread_mutex_lock(&profilingMutex);
+  if (profilingFile && __atomic_load_n(&profilingEnabled, __ATOMIC_RELAXED)) {
+    if (profilingBytes + bytes > profilingMaxBytes) {
+      // Out of budget: stop recording on every thread
+      __atomic_store_n(&profilingEnabled, 0, __ATOMIC_RELAXED);
+      fflush(profilingFile);
+      INFO(NCCL_INIT, "Proxy profile reached NCCL_PROXY_PROFILE_MAX_MB, recording stopped");
+    } else {
+      fwrite(&header, sizeof(header), 1, profilingFile);
+      fwrite(events, sizeof(struct ncclProxyProfileEvent), count, profilingFile);
+      profilingBytes += bytes;
+    }
+  }
+  pthread_mutex_unlock(&profilingMutex);
+}
+
+struct ncclProxyProfileBuffer {
+  uint32_t tid;
+  int count;
+  struct ncclProxyProfileEvent events[PROFILE_CHUNK_EVENTS];
+
+  ncclProxyProfileBuffer() : tid(syscall(SYS_gettid)), count(0) {}
+  ~ncclProxyProfileBuffer() { flush(); }
+  void flush() {
+    profilingWriteChunk(tid, events, count);
+    count = 0;
+  }
+};
+
+// The buffer is too large for TLS; the thread-local owner flushes and frees
+// it when the thread exits.
+static thread_local struct ncclProxyProfileBufferOwner {
+  struct ncclProxyProfileBuffer* buffer = NULL;
+  ~ncclProxyProfileBufferOwner() { delete buffer; }
+} profilingBuffer;
+
+static void profilingInit() {
+  const char* str = ncclGetEnv("NCCL_PROXY_PROFILE");
+  if (!str || str[0] == '\0') return;
+  const char* maxStr = ncclGetEnv("NCCL_PROXY_PROFILE_MAX_MB");
+  profilingMaxBytes = (maxStr ? strtoull(maxStr, NULL, 0) : 256ULL) << 20;
+
+  char path[PATH_MAX];
+  snprintf(path, sizeof(path), "%s.%d", str, getpid());
+  profilingFile = fopen(path, "w");
+  if (profilingFile == NULL) {
+    WARN("Unable to open proxy profile %s : %s", path, strerror(errno));
+    return;
   }
-  struct ncclProxyProfileEvent* event = NULL;
-  if (state%8 == 0) {
-    if (profilingIndex == MAX_EVENTS) return ncclSuccess;
-    args->subs[sub].profilingEvents[step%NCCL_STEPS] = event = profilingEvents+profilingIndex++;
-    if (state == ncclProxyProfileBegin) {
-      // Proxy operation information
-      event->opCount = args->opCount;
-      event->channel = args->subs[sub].channelId;
-      event->peer = args->subs[sub].peer;
-      event->type = args->pattern;
-      event->step = step;
-      event->opIndex = (((uint64_t)args)/sizeof(struct ncclProxyArgs))%256;
-    } else event->peer = -state;
+  struct ncclProxyProfileFileHeader header = { PROFILE_MAGIC, PROFILE_VERSION, sizeof(struct ncclProxyProfileEvent), getpid(), 0 };
+  fwrite(&header, sizeof(header), 1, profilingFile);
+  profilingBytes = sizeof(header);
+  __atomic_store_n(&profilingEnabled, 1, __ATOMIC_RELAXED);
+  INFO(NCCL_INIT, "Proxy profiling enabled, writing to %s", path);
+}
+
+ncclResult_t ncclProfilingRecord(struct ncclProxyArgs* args, int sub, int step, int state) {
+  pthread_once(&profilingOnce, profilingInit);
+  if (!__atomic_load_n(&profilingEnabled, __ATOMIC_RELAXED)) return ncclSuccess;
+
+  if (profilingBuffer.buffer == NULL) profilingBuffer.buffer = new ncclProxyProfileBuffer();
+  struct ncclProxyProfileBuffer* buffer = profilingBuffer.buffer;
+  struct ncclProxyProfileEvent* event = buffer->events+buffer->count;
+  struct timespec ts;
+  clock_gettime(CLOCK_REALTIME, &ts);
+  event->timestamp = 1000000000ULL*ts.tv_sec + ts.tv_nsec;
+  event->state = state;
+  event->step = step;
+  if (state < ncclProxyProfileSleep) {
+    // Proxy operation information
+    event->commHash = args->commHash;
+    event->funcTimes = args->ncclFuncTimes;
+    event->opCount = args->opCount;
+    event->argsId = (uint64_t)args;
+    event->channel = args->subs[sub].channelId;
+    event->peer = args->subs[sub].peer;
+    event->type = args->pattern;
   } else {
-    event = (struct ncclProxyProfileEvent*)args->subs[sub].profilingEvents[step%NCCL_STEPS];
-    if (state == ncclProxyProfileEnd) args->subs[sub].profilingEvents[step%NCCL_STEPS] = NULL;
-    if (state == ncclProxyProfileAppendEnd) event->opCount = args->opCount;
+    // Sleep/Idle/Append events only use a stack placeholder for args
+    event->commHash = event->funcTimes = event->argsId = 0;
+    event->opCount = state == ncclProxyProfileAppendEnd ? args->opCount : 0;
+    event->channel = 0;
+    event->peer = -1;
+    event->type = 0;
   }
-  // Timestamp
-  event->timestamp[state%8] = gettime()-profilingStart;
+  event->pad = 0;
+  if (++buffer->count == PROFILE_CHUNK_EVENTS) buffer->flush();
   return ncclSuccess;
 }
 
 void ncclProfilingDump() {
-  static int dumpDone = 0;
-  if (dumpDone) return;
-  dumpDone = 1;
-  const char* str = ncclGetEnv("NCCL_PROXY_PROFILE");
-  if (!str) { free(profilingEvents); return; }
-  FILE* f = fopen(str, "w");
-  fprintf(f, "[\n");
-
-  for (int i=0; i<profilingIndex; i++) {
-    struct ncclProxyProfileEvent* e = profilingEvents+i;
-    const int sendrecv = e->peer >= 0;
-    const char* typeStr = sendrecv ? (e->type == ncclPatternSend ? "Send" : "Recv") :
-      profilingEventStr[-(e->peer/8)];
-
-
-    if (sendrecv) {
-      int state = ncclProxyProfileBegin;
-      const char** stateStr = e->type == ncclPatternSend ? profilingStateSendStr : profilingStateRecvStr;
-      fprintf(f, "{\"name\": \"%s-%d-%d\", \"cat\": \"NET\", \"ph\": \"b\", \"id\": %d, \"pid\": %d, \"tid\": 1, \"ts\": %f, \"args\": { \"opCount\": %ld, \"proxyOpIndex\":%d } },\n",
-          typeStr, e->peer, e->step, i, e->channel, e->timestamp[state], e->opCount, e->opIndex);
-
-      while (state<ncclProxyProfileEnd) {
-        if (e->timestamp[state]) {
-          const char* name = stateStr[state];
-          fprintf(f, "{\"name\": \"%s\", \"cat\": \"NET\", \"ph\": \"b\", \"id\": %d, \"pid\": %d, \"tid\": 1, \"ts\": %f },\n",
-              name, i, e->channel, e->timestamp[state]);
-          state++;
-          while (e->timestamp[state] == 0) state++;
-          fprintf(f, "{\"name\": \"%s\", \"cat\": \"NET\", \"ph\": \"e\", \"id\": %d, \"pid\": %d, \"tid\": 1, \"ts\": %f },\n",
-              name, i, e->channel, e->timestamp[state]);
-        }
-      }
-
-      fprintf(f, "{\"name\": \"%s-%d-%d\", \"cat\": \"NET\", \"ph\": \"e\", \"id\": %d, \"pid\": %d, \"tid\": 1, \"ts\": %f },\n",
-          typeStr, e->peer, e->step, i, e->channel, e->timestamp[state]);
-    } else {
-      if (e->peer == -ncclProxyProfileAppend) {
-      fprintf(f, "{\"name\": \"%s\", \"cat\": \"NET\", \"ph\": \"b\", \"id\": %d, \"pid\": -1, \"tid\": 1, \"ts\": %f, \"args\": { \"added\": %ld } },\n",
-          typeStr, i, e->timestamp[0], e->opCount);
-      } else {
-        fprintf(f, "{\"name\": \"%s\", \"cat\": \"NET\", \"ph\": \"b\", \"id\": %d, \"pid\": -1, \"tid\": 1, \"ts\": %f },\n",
-          typeStr, i, e->timestamp[0]);
-      }
-      fprintf(f, "{\"name\": \"%s\", \"cat\": \"NET\", \"ph\": \"e\", \"id\": %d, \"pid\": -1, \"tid\": 1, \"ts\": %f },\n",
-          typeStr, i, e->timestamp[1]);
-    }
-  }
-  fprintf(f, "{} ]\n");
-  fclose(f);
-  free(profilingEvents);
+  if (!__atomic_load_n(&profilingEnabled, __ATOMIC_RELAXED)) return;
+  if (profilingBuffer.buffer) profilingBuffer.buffer->flush();
+  pthread_mutex_lock(&profilingMutex);
+  if (profilingFile) fflush(profilingFile);
+  pthread_mutex_unlock(&profilingMutex);
 }
-#else
-ncclResult_t ncclProfilingRecord(struct ncclProxyArgs* args, int sub, int step, int state) { return ncclSuccess; }
-void ncclProfilingDump() {}
-#endif
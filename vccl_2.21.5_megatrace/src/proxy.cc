@@ -403,6 +403,7 @@ static ncclResult_t ncclProxyOpToArgs(struct ncclProxyOp* op, struct ncclProxyAr
   args->ncclFuncTimes = op->ncclFuncTimes;
   args->peerRank = op->peerRank;
   args->groupHash = op->groupHash;
+  args->commHash = op->commHash;
   args->rank = op->rank;
   return ncclSuccess;
 }
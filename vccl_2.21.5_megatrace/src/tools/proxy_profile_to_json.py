@@ -0,0 +1,120 @@
+import argparse
+import json
+import struct
+import sys
+from collections import defaultdict
+
+# Converts the binary proxy profile written with NCCL_PROXY_PROFILE (misc/profiler.cc)
+# into Chrome trace JSON, loadable in chrome://tracing and Perfetto.
+
+PROFILE_MAGIC = 0x464f5250584f5250
+FILE_HEADER = struct.Struct("<QIIii")
+CHUNK_HEADER = struct.Struct("<II")
+EVENT = struct.Struct("<QQQQQiiHBBI")
+
+PATTERN_SEND = 11  # ncclPatternSend, see include/info.h
+STATE_BEGIN = 0
+STATE_END = 4
+SEND_STATES = {0: "BufferWait", 1: "GPUWait", 2: "SendWait", 3: "", 4: "End"}
+RECV_STATES = {0: "BufferWait", 1: "RecvWait", 2: "FlushWait", 3: "GPUWait", 4: "End"}
+# begin state -> (name, end state)
+THREAD_EVENTS = {8: ("Sleep", 9), 16: ("Idle", 17), 24: ("Append", 25)}
+
+
+def read_profile(path):
+    """
+    Yields (pid, tid, event tuple) for every record of the profile file.
+    """
+    with open(path, "rb") as f:
+        header = f.read(FILE_HEADER.size)
+        if len(header) < FILE_HEADER.size:
+            raise ValueError(f"{path}: truncated header")
+        magic, version, event_size, pid, _ = FILE_HEADER.unpack(header)
+        if magic != PROFILE_MAGIC or event_size != EVENT.size:
+            raise ValueError(f"{path}: not a proxy profile (version {version}, event size {event_size})")
+        while True:
+            chunk = f.read(CHUNK_HEADER.size)
+            if len(chunk) < CHUNK_HEADER.size:
+                break
+            tid, count = CHUNK_HEADER.unpack(chunk)
+            data = f.read(count * EVENT.size)
+            # a chunk cut short by a crash keeps its complete records
+            for event in EVENT.iter_unpack(data[:len(data) - len(data) % EVENT.size]):
+                yield pid, tid, event
+
+
+def convert(paths, output):
+    trace = []
+    start = None
+    events = []
+    for path in paths:
+        events.extend(read_profile(path))
+    if not events:
+        print("No proxy profile events found")
+        return
+    start = min(e[2][0] for e in events)
+
+    def us(ns):
+        return (ns - start) / 1000.0
+
+    # Proxy steps: every state of a step is a record with the same key;
+    # consecutive states become nested slices of the step slice.
+    steps = defaultdict(dict)
+    pending = {}
+    for pid, tid, e in events:
+        timestamp, comm_hash, func_times, op_count, args_id, peer, step, channel, type_, state, _ = e
+        if state < 8:
+            steps[(pid, tid, args_id, channel, peer, step, type_, op_count)][state] = (timestamp, comm_hash, func_times)
+        elif state in THREAD_EVENTS:
+            pending[(pid, tid, state)] = (timestamp, op_count)
+        else:
+            begin_state = state - 1
+            if (pid, tid, begin_state) not in pending:
+                continue
+            begin, _ = pending.pop((pid, tid, begin_state))
+            name = THREAD_EVENTS[begin_state][0]
+            args = {"added": op_count} if begin_state == 24 else {}
+            trace.append({"name": name, "cat": "PROXY", "ph": "X", "pid": pid, "tid": tid,
+                          "ts": us(begin), "dur": us(timestamp) - us(begin), "args": args})
+
+    for (pid, tid, args_id, channel, peer, step, type_, op_count), states in steps.items():
+        if STATE_BEGIN not in states or STATE_END not in states:
+            continue
+        is_send = type_ == PATTERN_SEND
+        names = SEND_STATES if is_send else RECV_STATES
+        begin, comm_hash, func_times = states[STATE_BEGIN]
+        end = states[STATE_END][0]
+        track = f"{tid}/ch{channel}"
+        trace.append({"name": f"{'Send' if is_send else 'Recv'}-{peer}-{step}", "cat": "NET", "ph": "X",
+                      "pid": pid, "tid": track, "ts": us(begin), "dur": us(end) - us(begin),
+                      "args": {"commHash": f"0x{comm_hash:x}", "funcTimes": func_times,
+                               "opCount": op_count, "channel": channel}})
+        ordered = sorted(states.items())
+        for (state, (t0, _, _)), (_, (t1, _, _)) in zip(ordered, ordered[1:]):
+            if names.get(state):
+                trace.append({"name": names[state], "cat": "NET", "ph": "X", "pid": pid, "tid": track,
+                              "ts": us(t0), "dur": us(t1) - us(t0)})
+
+    with open(output, "w") as f:
+        f.write("[\n")
+        for i, event in enumerate(trace):
+            f.write(json.dumps(event))
+            f.write(",\n" if i + 1 < len(trace) else "\n")
+        f.write("]\n")
+    print(f"{len(trace)} trace events written to {output} (time origin {start} ns)")
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Convert NCCL_PROXY_PROFILE files to Chrome trace JSON")
+    parser.add_argument("profiles", nargs="+", help="profile files (<NCCL_PROXY_PROFILE>.<pid>)")
+    parser.add_argument("-o", "--output", default="proxy_profile.json", help="output JSON file")
+    args = parser.parse_args()
+    try:
+        convert(args.profiles, args.output)
+    except (OSError, ValueError) as e:
+        print(e)
+        sys.exit(1)
+
+
+if __name__ == "__main__":
+    main()
@@ -171,6 +171,8 @@ extern ncclResult_t setNcclFuncTimes(void *netSendComm, unsigned long long ncclF
 extern ncclResult_t setNcclPeerRank(void *netSendComm, int rank);
 extern ncclResult_t setNcclGroupHash(void *netSendComm, uint64_t groupHash);
 extern ncclResult_t setNcclRank(void *netSendComm, int rank);
+extern ncclResult_t setNcclCommHash(void *netSendComm, uint64_t commHash);
+extern ncclResult_t ncclNetSocketSetTelemetryInfo(void* netComm, uint8_t func, unsigned long long ncclFuncTimes, int rank, int peerRank, uint64_t groupHash, uint64_t commHash);
 extern ncclNet_t* ncclNets[3];
 
 // Forward declaration
@@ -1133,6 +1135,9 @@ static ncclResult_t sendProxyProgress(struct ncclProxyState* proxyState, struct
               NCCLCHECK(setNcclPeerRank(resources->netSendComm, args->peerRank));
               NCCLCHECK(setNcclRank(resources->netSendComm, args->rank));
               NCCLCHECK(setNcclGroupHash(resources->netSendComm, args->groupHash));
+              NCCLCHECK(setNcclCommHash(resources->netSendComm, args->commHash));
+            } else if (proxyState->ncclNet == &ncclNetSocket) {
+              NCCLCHECK(ncclNetSocketSetTelemetryInfo(resources->netSendComm, args->coll, args->ncclFuncTimes, args->rank, args->peerRank, args->groupHash, args->commHash));
             }
             
             NCCLCHECK(proxyState->ncclNet->isend(resources->netSendComm, buff, size, resources->tpRank, sub->mhandle, sub->requests+buffSlot));
@@ -1293,6 +1298,9 @@ static ncclResult_t recvProxyProgress(struct ncclProxyState* proxyState, struct
         uint64_t step = subGroup->posted;
         struct recvNetResources* resources = (struct recvNetResources*) (subGroup->connection->transportResources);
         void** requestPtr = subGroup->requests+(step%NCCL_STEPS);
+        if (proxyState->ncclNet == &ncclNetSocket) {
+          NCCLCHECK(ncclNetSocketSetTelemetryInfo(resources->netRecvComm, args->coll, args->ncclFuncTimes, args->rank, args->peerRank, args->groupHash, args->commHash));
+        }
         NCCLCHECK(proxyState->ncclNet->irecv(resources->netRecvComm, subCount, ptrs, sizes, tags, mhandles, requestPtr));
         if (*requestPtr) {
           subGroup->recvRequestsCache[step%NCCL_STEPS] = *requestPtr;
@@ -843,6 +843,7 @@ struct ncclIbSendComm {
   int peerRank;
   int rank;
   uint64_t groupHash;
+  uint64_t commHash;
 };
 // The SendFifo needs to be 32-byte aligned and each element needs
 // to be a 32-byte multiple, so that an entry does not get split and
@@ -1445,6 +1446,10 @@ ncclResult_t ncclIbGetRequest(struct ncclIbNetCommBase* base, struct ncclIbReque
       r->events[0] = r->events[1] = 0;
       r->time = get_nanoseconds();
       r->time_out = 0;
+      // reqs live in ncclIbMalloc'd (zeroed) comms, so the socket-only
+      // columns would otherwise read as socket 0 on helper thread 0
+      for (int d = 0; d < NCCL_IB_MAX_DEVS_PER_NIC; d++)
+        r->log[d].sockIndex = r->log[d].helperThread = -1;
       *req = r;
       return ncclSuccess;
     }
@@ -1783,6 +1788,7 @@ ncclResult_t ncclIbIsend(void* sendComm, void* data, int size, int tag, void* mh
       req->log[devIndex].ncclFuncTimes = comm->ncclFuncTimes;
       req->log[devIndex].peerRank = comm->peerRank;
       req->log[devIndex].groupHash = comm->groupHash;
+      req->log[devIndex].commHash = comm->commHash;
       
       req->log[devIndex].NetworkCardName = qp->NetworkCardName;
       //INFO(NCCL_INIT,"-req->log[devIndex].NetworkCardName:%s-",req->log[devIndex].NetworkCardName.c_str());
@@ -2227,6 +2233,12 @@ ncclResult_t setNcclGroupHash(void *netSendComm, uint64_t groupHash){
   return ncclSuccess;
 }
 
+ncclResult_t setNcclCommHash(void *netSendComm, uint64_t commHash){
+  struct ncclIbSendComm* comm = (struct ncclIbSendComm*)netSendComm;
+  comm->commHash = commHash;
+  return ncclSuccess;
+}
+
 
 ncclNet_t ncclNetIb = {
   "IB",
@@ -9,6 +9,7 @@
 #include "socket.h"
 #include "net.h"
 #include "param.h"
+#include "timer_log.h"
 
 #include <pthread.h>
 #include <stdlib.h>
@@ -148,6 +149,8 @@ struct ncclNetSocketTask {
   int offset;
   int used;
   ncclResult_t result;
+  int sockIndex;
+  int tid;
 };
 
 struct ncclNetSocketRequest {
@@ -160,6 +163,7 @@ struct ncclNetSocketRequest {
   struct ncclNetSocketComm* comm;
   struct ncclNetSocketTask* tasks[MAX_SOCKETS];
   int nSubs;
+  struct timer_log log;
 };
 
 struct ncclNetSocketTaskQueue {
@@ -195,8 +199,86 @@ struct ncclNetSocketComm {
   struct ncclNetSocketRequest requests[MAX_REQUESTS];
   pthread_t helperThread[MAX_THREADS];
   struct ncclNetSocketThreadResources threadResources[MAX_THREADS];
+  uint8_t func;
+  unsigned long long ncclFuncTimes;
+  int peerRank;
+  int rank;
+  uint64_t groupHash;
+  uint64_t commHash;
 };
 
+// count the number of in-flight requests and bytes, mirrors sendWrCounter/remainWrDataSize in net_ib.cc
+thread_local int socketInflightCounter = 0;
+thread_local int socketInflightDataSize = 0;
+
+static void ncclNetSocketCopyIp(const union ncclSocketAddress* addr, uint8_t* ip) {
+  if (addr->sa.sa_family == AF_INET) {
+    memcpy(ip, &addr->sin.sin_addr.s_addr, 4);
+  } else {
+    memset(ip, 0, 4);
+  }
+}
+
+static void ncclNetSocketLogStart(struct ncclNetSocketRequest* r) {
+  if (!global_timer_log.collect) {
+    r->log.loged_start = NCCL_LOG_NOT_USE;
+    return;
+  }
+  struct ncclNetSocketComm* comm = r->comm;
+  r->log.loged_start = NCCL_LOG_TELEMETRY;
+  clock_gettime(CLOCK_REALTIME, &r->log.send_start);
+  r->log.func = comm->func;
+  r->log.ncclFuncTimes = comm->ncclFuncTimes;
+  r->log.groupHash = comm->groupHash;
+  r->log.commHash = comm->commHash;
+  r->log.devIndex = 0;
+  r->log.size = 0;
+  r->log.sockIndex = -1;
+  r->log.helperThread = -1;
+  r->log.NetworkCardName = ncclNetSocketDevs[comm->dev].devName;
+  // Rows describe the data flow: a receive is logged from the remote sender to this rank
+  int isSend = r->op == NCCL_SOCKET_SEND;
+  r->log.rank = isSend ? comm->rank : comm->peerRank;
+  r->log.peerRank = isSend ? comm->peerRank : comm->rank;
+  ncclNetSocketCopyIp(&ncclNetSocketDevs[comm->dev].addr, isSend ? r->log.srcIp : r->log.dscIp);
+  ncclNetSocketCopyIp(&comm->ctrlSock.addr, isSend ? r->log.dscIp : r->log.srcIp);
+  socketInflightCounter++;
+}
+
+static void ncclNetSocketLogEnd(struct ncclNetSocketRequest* r) {
+  if (r->log.loged_start != NCCL_LOG_TELEMETRY) return;
+  r->log.loged_start = NCCL_LOG_NOT_USE;
+  socketInflightCounter--;
+  socketInflightDataSize -= r->size;
+  if (!global_timer_log.collect) return;
+  clock_gettime(CLOCK_REALTIME, &r->log.send_end);
+  r->log.diff = 1000000000L * (r->log.send_end.tv_sec) + r->log.send_end.tv_nsec;
+  r->log.size = r->size;
+  r->log.sendWrCounter = socketInflightCounter;
+  r->log.remainWrDataSize = socketInflightDataSize;
+  if (r->nSubs > 0) {
+    r->log.sockIndex = r->tasks[0]->sockIndex;
+    r->log.helperThread = r->tasks[0]->tid;
+  }
+  if (r->log.size > 16) {
+    pthread_mutex_lock(&global_timer_log.lock);
+    __sync_synchronize();
+    global_timer_log.push(r->log);
+    pthread_mutex_unlock(&global_timer_log.lock);
+  }
+}
+
+ncclResult_t ncclNetSocketSetTelemetryInfo(void* netComm, uint8_t func, unsigned long long ncclFuncTimes, int rank, int peerRank, uint64_t groupHash, uint64_t commHash) {
+  struct ncclNetSocketComm* comm = (struct ncclNetSocketComm*)netComm;
+  comm->func = func;
+  comm->ncclFuncTimes = ncclFuncTimes;
+  comm->rank = rank;
+  comm->peerRank = peerRank;
+  comm->groupHash = groupHash;
+  comm->commHash = commHash;
+  return ncclSuccess;
+}
+
 void* persistentSocketThread(void *args_) {
   struct ncclNetSocketThreadResources* resource = (struct ncclNetSocketThreadResources*)args_;
   struct ncclNetSocketComm* comm = resource->comm;
@@ -446,6 +528,8 @@ ncclResult_t ncclNetSocketGetTask(struct ncclNetSocketComm* comm, int op, void*
     r->data = data;
     r->size = size;
     r->sock = comm->socks + comm->nextSock;
+    r->sockIndex = comm->nextSock;
+    r->tid = tid;
     r->offset = 0;
     r->result = ncclSuccess;
     comm->nextSock = (comm->nextSock + 1) % comm->nSocks;
@@ -491,6 +575,7 @@ ncclResult_t ncclNetSocketTest(void* request, int* done, int* size) {
     r->size = data;
     r->offset = 0;
     r->used = 2; // done exchanging size
+    if (r->log.loged_start == NCCL_LOG_TELEMETRY) socketInflightDataSize += r->size;
     // divide into subtasks
     int chunkOffset = 0, i = 0;
     if (r->comm->nSocks > 0) {
@@ -516,6 +601,7 @@ ncclResult_t ncclNetSocketTest(void* request, int* done, int* size) {
         if (size) *size = r->size;
         *done = 1;
         r->used = 0;
+        ncclNetSocketLogEnd(r);
         for (int i=0; i<r->nSubs; i++) {
           struct ncclNetSocketTask* sub = r->tasks[i];
           sub->used = 0;
@@ -529,6 +615,7 @@ ncclResult_t ncclNetSocketTest(void* request, int* done, int* size) {
         if (size) *size = r->size;
         *done = 1;
         r->used = 0;
+        ncclNetSocketLogEnd(r);
       }
     }
   }
@@ -543,6 +630,7 @@ ncclResult_t ncclNetSocketDeregMr(void* comm, void* mhandle) { return ncclSucces
 ncclResult_t ncclNetSocketIsend(void* sendComm, void* data, int size, int tag, void* mhandle, void** request) {
   struct ncclNetSocketComm* comm = (struct ncclNetSocketComm*)sendComm;
   NCCLCHECK(ncclNetSocketGetRequest(comm, NCCL_SOCKET_SEND, data, size, (struct ncclNetSocketRequest**)request));
+  ncclNetSocketLogStart(*(struct ncclNetSocketRequest**)request);
   return ncclSuccess;
 }
 
@@ -550,6 +638,7 @@ ncclResult_t ncclNetSocketIrecv(void* recvComm, int n, void** data, int* sizes,
   struct ncclNetSocketComm* comm = (struct ncclNetSocketComm*)recvComm;
   if (n != 1) return ncclInternalError;
   NCCLCHECK(ncclNetSocketGetRequest(comm, NCCL_SOCKET_RECV, data[0], sizes[0], (struct ncclNetSocketRequest**)request));
+  ncclNetSocketLogStart(*(struct ncclNetSocketRequest**)request);
   return ncclSuccess;
 }
 
@@ -136,7 +136,7 @@ void *log_writer_thread(void *arg) {
     return NULL;
 }
 
-void log_event(struct timespec time_api, size_t count, const char* opName, cudaStream_t stream) {
+void log_event(struct timespec time_api, size_t count, const char* opName, cudaStream_t stream, uint64_t commHash, unsigned long long opCount) {
     // 用于格式化日志信息
     char log_msg[LOG_MAX_LEN];
 
@@ -145,9 +145,9 @@ void log_event(struct timespec time_api, size_t count, const char* opName, cudaS
     snprintf(time_str, sizeof(time_str), "%ld.%09ld", time_api.tv_sec, time_api.tv_nsec);
     const char *rank_str = getenv("OMPI_COMM_WORLD_RANK");
     int rank = atoi(rank_str);
-    // 格式化日志内容
-    snprintf(log_msg, sizeof(log_msg), "[%s] [Rank %d] Fun %s Data %zu stream %p",
-             time_str,rank ,opName, count, (void*)stream);
+    // 格式化日志内容，(comm, op) 与 telemetry 的 (CommHash, FuncTimes) 对应
+    snprintf(log_msg, sizeof(log_msg), "[%s] [Rank %d] Fun %s Data %zu stream %p comm 0x%lx op %llu",
+             time_str,rank ,opName, count, (void*)stream, commHash, opCount);
     int num = ring_buffer_count(&ring_nccl_log);
     // 将格式化后的日志写入环形缓冲区
     if (ring_buffer_push(&ring_nccl_log, log_msg) != 0) {
@@ -10,11 +10,19 @@
 #include <sstream>
 #include <map>
 #include <chrono>
+#include <cmath>
 
 const int nccl_telemetry_enable = ncclGetEnv("NCCL_TELEMETRY_ENABLE") ? atoi(ncclGetEnv("NCCL_TELEMETRY_ENABLE")) : 0;
 const char* nccl_telemetry_log_path = ncclGetEnv("NCCL_TELEMETRY_LOG_PATH");
 using Clock = std::chrono::steady_clock;
 
+// online link-degradation detector, see linkDegradeUpdate()
+const double linkDegradeSigma = ncclGetEnv("TELEMETRY_DEGRADE_SIGMA") ? atof(ncclGetEnv("TELEMETRY_DEGRADE_SIGMA")) : 3.0;
+const int linkDegradeWindow = ncclGetEnv("TELEMETRY_DEGRADE_WINDOW") ? atoi(ncclGetEnv("TELEMETRY_DEGRADE_WINDOW")) : 20;
+const double linkDegradeAlpha = ncclGetEnv("TELEMETRY_DEGRADE_ALPHA") ? atof(ncclGetEnv("TELEMETRY_DEGRADE_ALPHA")) : 0.05;
+const int linkDegradeWarmup = ncclGetEnv("TELEMETRY_DEGRADE_WARMUP") ? atoi(ncclGetEnv("TELEMETRY_DEGRADE_WARMUP")) : 100;
+const int linkDegradeWarn = ncclGetEnv("TELEMETRY_DEGRADE_WARN") ? atoi(ncclGetEnv("TELEMETRY_DEGRADE_WARN")) : 0;
+
 std::string getCurrentTimeString() {
     std::time_t now = std::time(nullptr);
     std::tm* localTime = std::localtime(&now);
@@ -41,6 +49,102 @@ struct PortLogs {
 };
 std::map<std::string, std::map<int, PortLogs>> logFilesMap; // 网卡名 -> 端口 -> 日志文件
 
+struct linkBaseline {
+  double bwMean = 0;
+  double bwVar = 0;
+  double latMean = 0;
+  double latVar = 0;
+  long long samples = 0;
+  int lowCount = 0;       // consecutive samples outside the k·σ band
+  bool alerted = false;
+};
+std::map<std::string, linkBaseline> linkBaselines; // "网卡名:端口:对端IP:size桶" -> baseline
+std::ofstream linkAlertFile;
+
+#define TELEMETRY_ALERT_HEADER "Time,NIC,DevIndex,FromRank,ToRank,SrcIP,DstIP,State,Bandwidth,BaselineBandwidth,BandwidthSigma,Latency,BaselineLatency,LatencySigma,Samples,Timestamp\n"
+
+static void ewmaUpdate(double x, double& mean, double& var) {
+  double diff = x - mean;
+  double incr = linkDegradeAlpha * diff;
+  mean += incr;
+  var = (1 - linkDegradeAlpha) * (var + diff * incr);
+}
+
+static void writeLinkAlert(const timer_log& log, const linkBaseline& base, const char* state, double bw, double lat) {
+  if (!linkAlertFile.is_open()) {
+    char hostname[1024];
+    getHostName(hostname, 1024, '.');
+    std::string filename = std::string(nccl_telemetry_log_path) + "/" + hostname + "_LinkAlert.log";
+    linkAlertFile.open(filename, std::ios::trunc);
+    linkAlertFile << TELEMETRY_ALERT_HEADER;
+  }
+  char dataBuffer[512];
+  sprintf(dataBuffer, "%s,%s,%d,%d,%d,%d.%d.%d.%d,%d.%d.%d.%d,%s,%.3f,%.3f,%.3f,%.0f,%.0f,%.0f,%lld,%lld",
+          getCurrentTimeString().c_str(), log.NetworkCardName.c_str(), log.devIndex, log.rank, log.peerRank,
+          log.srcIp[0], log.srcIp[1], log.srcIp[2], log.srcIp[3],
+          log.dscIp[0], log.dscIp[1], log.dscIp[2], log.dscIp[3],
+          state, bw, base.bwMean, sqrt(base.bwVar), lat, base.latMean, sqrt(base.latVar),
+          base.samples, log.diff);
+  linkAlertFile << dataBuffer << std::endl;
+  if (linkDegradeWarn) {
+    WARN("[Telemetry] link %s port %d rank %d->%d %s: %.3f Gbps (baseline %.3f±%.3f), WR latency %.0f ns (baseline %.0f±%.0f)",
+         log.NetworkCardName.c_str(), log.devIndex, log.rank, log.peerRank, state,
+         bw, base.bwMean, sqrt(base.bwVar), lat, base.latMean, sqrt(base.latVar));
+  }
+}
+
+/* Keep an EWMA mean/variance of the per-request bandwidth and WR latency of
+ * every (NIC, port, remote IP, size bucket) and raise an alert once a link
+ * stays outside mean ± k·σ for linkDegradeWindow consecutive requests.
+ * peerRank is local to a communicator, so the remote host is told apart by
+ * its IP; request latency grows with size, so each power-of-two size range
+ * has its own baseline and large DP chunks are not judged against small PP
+ * messages. Degraded samples do not feed the baseline, so a slowly failing
+ * link cannot drag it down. */
+static void linkDegradeUpdate(const timer_log& log) {
+  unsigned long long startTime = 1000000000ULL * log.send_start.tv_sec + log.send_start.tv_nsec;
+  if (log.diff <= startTime || log.size <= 0) return;
+  double lat = (double)(log.diff - startTime);
+  double bw = log.size * 8.0 / lat; // Gbps
+
+  int sizeBucket = 0;
+  for (long long size = log.size; size > 1; size >>= 1) sizeBucket++;
+  char remote[32];
+  snprintf(remote, sizeof(remote), "%d.%d.%d.%d", log.dscIp[0], log.dscIp[1], log.dscIp[2], log.dscIp[3]);
+  std::string key = log.NetworkCardName + ":" + std::to_string(log.devIndex) + ":" + remote + ":" + std::to_string(sizeBucket);
+  linkBaseline& base = linkBaselines[key];
+  if (base.samples < linkDegradeWarmup) {
+    if (base.samples == 0) {
+      base.bwMean = bw;
+      base.latMean = lat;
+    } else {
+      ewmaUpdate(bw, base.bwMean, base.bwVar);
+      ewmaUpdate(lat, base.latMean, base.latVar);
+    }
+    base.samples++;
+    return;
+  }
+
+  bool degraded = bw < base.bwMean - linkDegradeSigma * sqrt(base.bwVar) ||
+                  lat > base.latMean + linkDegradeSigma * sqrt(base.latVar);
+  if (degraded) {
+    base.lowCount++;
+    if (base.lowCount >= linkDegradeWindow && !base.alerted) {
+      base.alerted = true;
+      writeLinkAlert(log, base, "DEGRADED", bw, lat);
+    }
+    return;
+  }
+  if (base.alerted) writeLinkAlert(log, base, "RECOVERED", bw, lat);
+  base.lowCount = 0;
+  base.alerted = false;
+  ewmaUpdate(bw, base.bwMean, base.bwVar);
+  ewmaUpdate(lat, base.latMean, base.latVar);
+  base.samples++;
+}
+
+#define TELEMETRY_LOG_HEADER "Time,Group,FromRank,ToRank,DevIndex,Func,FuncTimes,SrcIP,DstIP,Bandwidth,SendWrCounter,RemainWrDataSize,Timestamp,Bytes,StartTimestamp,SockIndex,HelperThread,CommHash\n"
+
 void* timerLogService(void *args){
   // signal(SIGPIPE, sigpipe_handler);
   //setupTelemetry();//set up environment variables
@@ -73,6 +177,7 @@ void* timerLogService(void *args){
         // update slide window
         global_timer_log.pushSlideWindow(log, log.devIndex);
         pthread_mutex_unlock(&global_timer_log.lock);
+        linkDegradeUpdate(log);
         if (global_timer_log.slideWindow[log.devIndex].size() < maxWindowSize) {
           continue;
         }
@@ -89,7 +194,7 @@ void* timerLogService(void *args){
                                    (i == 0 ? "_A.log" : "_B.log");
             portLogs.filenames[i] = filename;
             portLogs.files[i].open(filename, std::ios::trunc);
-            portLogs.files[i] << "Time,Group,FromRank,ToRank,DevIndex,Func,FuncTimes,SrcIP,DstIP,Bandwidth,SendWrCounter,RemainWrDataSize,Timestamp\n";
+            portLogs.files[i] << TELEMETRY_LOG_HEADER;
             portLogs.headerWritten[i] = true;
             // portLogs.startTime[i] = Clock::now();
           }
@@ -113,19 +218,21 @@ void* timerLogService(void *args){
           pFile = &portLogs.files[portLogs.currentFile];
           
           pFile->open(portLogs.filenames[portLogs.currentFile], std::ios::trunc);
-          *pFile << "Time,Group,FromRank,ToRank,DevIndex,Func,FuncTimes,SrcIP,DstIP,Bandwidth,SendWrCounter,RemainWrDataSize,Timestamp\n";
+          *pFile << TELEMETRY_LOG_HEADER;
           portLogs.headerWritten[portLogs.currentFile] = true;
           // 为下一次轮转重新记起点
           // portLogs.startTime[portLogs.currentFile] = Clock::now();
         }
         int bandWidths = global_timer_log.getBandWidths(log.devIndex);
+        unsigned long long startTime = 1000000000ULL * log.send_start.tv_sec + log.send_start.tv_nsec;
         char dataBuffer[512];
-        sprintf(dataBuffer, "%s,%lu,%d,%d,%d,%u,%lld,%d.%d.%d.%d,%d.%d.%d.%d,%d,%d,%d,%lld",
+        sprintf(dataBuffer, "%s,%lu,%d,%d,%d,%u,%lld,%d.%d.%d.%d,%d.%d.%d.%d,%d,%d,%d,%lld,%d,%llu,%d,%d,0x%lx",
                 getCurrentTimeString().c_str(), log.groupHash, log.rank, log.peerRank, log.devIndex,
                 log.func, log.ncclFuncTimes,
                 log.srcIp[0], log.srcIp[1], log.srcIp[2], log.srcIp[3],
                 log.dscIp[0], log.dscIp[1], log.dscIp[2], log.dscIp[3],
-                bandWidths, log.sendWrCounter, log.remainWrDataSize, log.diff);
+                bandWidths, log.sendWrCounter, log.remainWrDataSize, log.diff,
+                log.size, startTime, log.sockIndex, log.helperThread, log.commHash);
         (*pFile) << dataBuffer << std::endl;
       }
     }
@@ -135,6 +242,7 @@ void* timerLogService(void *args){
           port.second.files[1].close();
       }
     }
+    if (linkAlertFile.is_open()) linkAlertFile.close();
   }
   return 0;
 }
\ No newline at end of file